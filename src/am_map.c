@@ -30,6 +30,7 @@
 #include "doomdef.h"
 #include "st_stuff.h"
 #include "m_fixed.h"
+#include "m_bbox.h"
 #include "p_mobj.h"
 #include "d_player.h"
 #include "r_defs.h"
@@ -227,8 +228,6 @@ static int  grid = 0;
 static int  leveljuststarted = 1;   // kluge until AM_LevelInit() is called
 
 bool     automapactive = false;
-static int  finit_width = SCREENWIDTH;
-static int  finit_height = SCREENHEIGHT - 32;
 
 // location of window on screen
 static int  f_x;
@@ -580,8 +579,8 @@ void AM_LevelInit(void)
   leveljuststarted = 0;
 
   f_x = f_y = 0;
-  f_w = finit_width;
-  f_h = finit_height;
+  f_w = SCREENWIDTH;
+  f_h = V_ScaleY (ST_Y);
 
   AM_clearMarks();
 
@@ -943,37 +942,22 @@ void AM_clearFB(int color)
 // faster reject and precalculated slopes.  If the speed is needed,
 // use a hash algorithm to handle  the common cases.
 //
-bool
-AM_clipMline
-( mline_t*  ml,
-  fline_t*  fl )
+enum
 {
-  enum
-  {
-    LEFT  = 1,
-    RIGHT = 2,
-    BOTTOM  = 4,
-    TOP = 8
-  };
-
-  register int outcode1 = 0;
-  register int outcode2 = 0;
-  register int outside;
-
-  fpoint_t  tmp;
-  int   dx;
-  int   dy;
-
-
-#define DOOUTCODE(oc, mx, my) \
-    (oc) = 0; \
-    if ((my) < 0) (oc) |= TOP; \
-    else if ((my) >= f_h) (oc) |= BOTTOM; \
-    if ((mx) < 0) (oc) |= LEFT; \
-    else if ((mx) >= f_w) (oc) |= RIGHT;
+  LEFT  = 1,
+  RIGHT = 2,
+  BOTTOM  = 4,
+  TOP = 8
+};
 
+//
+// The trivial reject, in map coordinates.
+//
+static bool AM_rejectMline(mline_t* ml)
+{
+  int outcode1 = 0;
+  int outcode2 = 0;
 
-  // do trivial rejects and outcodes
   if (ml->a.y > m_y2)
   {
     outcode1 = TOP;
@@ -994,7 +978,7 @@ AM_clipMline
 
   if (outcode1 & outcode2)
   {
-    return false;  // trivially outside
+    return true;  // trivially outside
   }
 
   if (ml->a.x < m_x)
@@ -1015,16 +999,30 @@ AM_clipMline
     outcode2 |= RIGHT;
   }
 
-  if (outcode1 & outcode2)
-  {
-    return false;  // trivially outside
-  }
+  return (outcode1 & outcode2) != 0;  // trivially outside
+}
+
+//
+// Clips a line already in frame-buffer coordinates.
+//
+static bool AM_clipFline(fline_t* fl)
+{
+  register int outcode1 = 0;
+  register int outcode2 = 0;
+  register int outside;
+
+  fpoint_t  tmp;
+  int   dx;
+  int   dy;
+
+
+#define DOOUTCODE(oc, mx, my) \
+    (oc) = 0; \
+    if ((my) < 0) (oc) |= TOP; \
+    else if ((my) >= f_h) (oc) |= BOTTOM; \
+    if ((mx) < 0) (oc) |= LEFT; \
+    else if ((mx) >= f_w) (oc) |= RIGHT;
 
-  // transform to frame-buffer coordinates.
-  fl->a.x = CXMTOF(ml->a.x);
-  fl->a.y = CYMTOF(ml->a.y);
-  fl->b.x = CXMTOF(ml->b.x);
-  fl->b.y = CYMTOF(ml->b.y);
 
   DOOUTCODE(outcode1, fl->a.x, fl->a.y);
   DOOUTCODE(outcode2, fl->b.x, fl->b.y);
@@ -1098,17 +1096,36 @@ AM_clipMline
 }
 #undef DOOUTCODE
 
+bool
+AM_clipMline
+( mline_t*  ml,
+  fline_t*  fl )
+{
+  if (AM_rejectMline(ml))
+  {
+    return false;
+  }
+
+  // transform to frame-buffer coordinates.
+  fl->a.x = CXMTOF(ml->a.x);
+  fl->a.y = CYMTOF(ml->a.y);
+  fl->b.x = CXMTOF(ml->b.x);
+  fl->b.y = CYMTOF(ml->b.y);
+
+  return AM_clipFline(fl);
+}
+
 
 //
 // Classic Bresenham w/ whatever optimizations needed for speed
+// Steps a pointer into the frame buffer instead of computing
+//  every dot, and fills horizontal lines with memset.
 //
 void
 AM_drawFline
 ( fline_t*  fl,
   int   color )
 {
-  register int x;
-  register int y;
   register int dx;
   register int dy;
   register int sx;
@@ -1116,6 +1133,9 @@ AM_drawFline
   register int ax;
   register int ay;
   register int d;
+  register int count;
+  register int step;
+  register uint8_t* dest;
 
   static int fuck = 0;
 
@@ -1129,55 +1149,51 @@ AM_drawFline
     return;
   }
 
-#define PUTDOT(xx,yy,cc) fb[(yy)*f_w+(xx)]=(cc)
-
   dx = fl->b.x - fl->a.x;
   ax = 2 * (dx < 0 ? -dx : dx);
   sx = dx < 0 ? -1 : 1;
 
   dy = fl->b.y - fl->a.y;
   ay = 2 * (dy < 0 ? -dy : dy);
-  sy = dy < 0 ? -1 : 1;
+  sy = dy < 0 ? -f_w : f_w;
 
-  x = fl->a.x;
-  y = fl->a.y;
+  dest = fb + fl->a.y * f_w + fl->a.x;
+
+  if (!dy)
+  {
+    memset(dx < 0 ? dest + dx : dest, color, ax / 2 + 1);
+    return;
+  }
 
   if (ax > ay)
   {
     d = ay - ax / 2;
-    while (1)
+    for (count = ax / 2; ; count--)
     {
-      PUTDOT(x, y, color);
-      if (x == fl->b.x)
+      *dest = color;
+      if (!count)
       {
         return;
       }
-      if (d >= 0)
-      {
-        y += sy;
-        d -= ax;
-      }
-      x += sx;
-      d += ay;
+      // step is all ones when d >= 0, without a branch to mispredict
+      step = ~(d >> 31);
+      dest += (sy & step) + sx;
+      d += ay - (ax & step);
     }
   }
   else
   {
     d = ax - ay / 2;
-    while (1)
+    for (count = ay / 2; ; count--)
     {
-      PUTDOT(x, y, color);
-      if (y == fl->b.y)
+      *dest = color;
+      if (!count)
       {
         return;
       }
-      if (d >= 0)
-      {
-        x += sx;
-        d -= ay;
-      }
-      y += sy;
-      d += ax;
+      step = ~(d >> 31);
+      dest += (sx & step) + sy;
+      d += ax - (ay & step);
     }
   }
 }
@@ -1246,72 +1262,369 @@ void AM_drawGrid(int color)
 
 }
 
+//
+// Line grid.
+// The lines are binned by their bounding boxes into a grid of
+//  at most AMGRIDSIZE cells a side, built the first time a
+//  level's map is drawn. Only the lines in the cells under the
+//  window are looked at; any other one would fail the trivial
+//  reject anyway. They are marked in a bitmap and drawn in line
+//  order, so where lines cross the same one ends up on top.
+// The vertexes of the lines in view are transformed in one pass
+//  after the window moves or zooms, and not at all otherwise.
+//
+#define AMGRIDSIZE  64
+
+// Cell c holds amgridlines[amgrid[c]] up to amgrid[c + 1].
+// amgrid owns the PU_LEVEL block, so it is NULL on a new level.
+static int*   amgrid;
+static int*   amgridlines;
+static uint32_t*  amvisible;
+static fpoint_t*  amvertexes;
+static int    amgridwidth;
+static int    amgridheight;
+static int    amgridshift;
+static fixed_t  amgridx;
+static fixed_t  amgridy;
+
+// Window amvertexes were last worked out for.
+static bool   amtransformed;
+static fixed_t  amtransformkey[6];
+
+
+static int
+AM_gridCell
+( fixed_t v,
+  fixed_t origin,
+  int   size )
+{
+  int64_t cell;
+
+  cell = ((int64_t) v - origin) >> amgridshift;
+
+  if (cell < 0)
+  {
+    return 0;
+  }
+  if (cell >= size)
+  {
+    return size - 1;
+  }
+  return cell;
+}
+
+static void AM_buildGrid(void)
+{
+  fixed_t hix, hiy;
+  fixed_t*  bbox;
+  int   refs;
+  int   size;
+  int   i, x, y;
+  int   x0, x1, y0, y1;
+  int   cells;
+
+  amgridx = amgridy = INT_MAX;
+  hix = hiy = INT_MIN;
+
+  for (i = 0; i < numlines; i++)
+  {
+    bbox = lines[i].bbox;
+    if (bbox[BOXLEFT] < amgridx)
+    {
+      amgridx = bbox[BOXLEFT];
+    }
+    if (bbox[BOXRIGHT] > hix)
+    {
+      hix = bbox[BOXRIGHT];
+    }
+    if (bbox[BOXBOTTOM] < amgridy)
+    {
+      amgridy = bbox[BOXBOTTOM];
+    }
+    if (bbox[BOXTOP] > hiy)
+    {
+      hiy = bbox[BOXTOP];
+    }
+  }
+
+  // 128 unit cells, or larger to stay within AMGRIDSIZE.
+  amgridshift = FRACBITS + 7;
+  while ((((int64_t) hix - amgridx) >> amgridshift) >= AMGRIDSIZE
+         || (((int64_t) hiy - amgridy) >> amgridshift) >= AMGRIDSIZE)
+  {
+    amgridshift++;
+  }
+
+  amgridwidth = AM_gridCell(hix, amgridx, AMGRIDSIZE) + 1;
+  amgridheight = AM_gridCell(hiy, amgridy, AMGRIDSIZE) + 1;
+  cells = amgridwidth * amgridheight;
+
+  refs = 0;
+  for (i = 0; i < numlines; i++)
+  {
+    bbox = lines[i].bbox;
+    refs += (AM_gridCell(bbox[BOXRIGHT], amgridx, amgridwidth)
+             - AM_gridCell(bbox[BOXLEFT], amgridx, amgridwidth) + 1)
+            * (AM_gridCell(bbox[BOXTOP], amgridy, amgridheight)
+               - AM_gridCell(bbox[BOXBOTTOM], amgridy, amgridheight) + 1);
+  }
+
+  size = (cells + 1 + refs) * sizeof(int)
+         + (numlines + 31) / 32 * sizeof(uint32_t)
+         + numvertexes * sizeof(fpoint_t);
+
+  Z_Malloc(size, PU_LEVEL, &amgrid);
+  amvertexes = (fpoint_t*) (amgrid + cells + 1 + refs);
+  amvisible = (uint32_t*) (amvertexes + numvertexes);
+  amgridlines = amgrid + cells + 1;
+
+  memset(amgrid, 0, (cells + 1) * sizeof(int));
+
+  // Count the lines of each cell in amgrid[cell + 1],
+  //  sum them into the starts, and fill the cells in.
+  for (i = 0; i < numlines; i++)
+  {
+    bbox = lines[i].bbox;
+    x0 = AM_gridCell(bbox[BOXLEFT], amgridx, amgridwidth);
+    x1 = AM_gridCell(bbox[BOXRIGHT], amgridx, amgridwidth);
+    y0 = AM_gridCell(bbox[BOXBOTTOM], amgridy, amgridheight);
+    y1 = AM_gridCell(bbox[BOXTOP], amgridy, amgridheight);
+
+    for (y = y0; y <= y1; y++)
+      for (x = x0; x <= x1; x++)
+      {
+        amgrid[y * amgridwidth + x + 1]++;
+      }
+  }
+
+  for (i = 0; i < cells; i++)
+  {
+    amgrid[i + 1] += amgrid[i];
+  }
+
+  for (i = 0; i < numlines; i++)
+  {
+    bbox = lines[i].bbox;
+    x0 = AM_gridCell(bbox[BOXLEFT], amgridx, amgridwidth);
+    x1 = AM_gridCell(bbox[BOXRIGHT], amgridx, amgridwidth);
+    y0 = AM_gridCell(bbox[BOXBOTTOM], amgridy, amgridheight);
+    y1 = AM_gridCell(bbox[BOXTOP], amgridy, amgridheight);
+
+    // amgrid[c] runs ahead as the cell fills,
+    //  ending up where cell c + 1 starts.
+    for (y = y0; y <= y1; y++)
+      for (x = x0; x <= x1; x++)
+      {
+        amgridlines[amgrid[y * amgridwidth + x]++] = i;
+      }
+  }
+
+  memmove(amgrid + 1, amgrid, cells * sizeof(int));
+  amgrid[0] = 0;
+
+  // Nothing transformed yet.
+  amtransformed = false;
+}
+
+//
+// Frame-buffer positions of the vertexes of a line.
+//
+static void AM_transformLine(line_t* line)
+{
+  fpoint_t* p;
+
+  p = &amvertexes[line->v1 - vertexes];
+  p->x = CXMTOF(line->v1->x);
+  p->y = CYMTOF(line->v1->y);
+
+  p = &amvertexes[line->v2 - vertexes];
+  p->x = CXMTOF(line->v2->x);
+  p->y = CYMTOF(line->v2->y);
+}
+
+//
+// AM_drawMline for a linedef, through the cached vertexes.
+//
+static void
+AM_drawWallLine
+( line_t* line,
+  int   color )
+{
+  mline_t ml;
+  fline_t fl;
+
+  ml.a.x = line->v1->x;
+  ml.a.y = line->v1->y;
+  ml.b.x = line->v2->x;
+  ml.b.y = line->v2->y;
+
+  if (AM_rejectMline(&ml))
+  {
+    return;
+  }
+
+  fl.a = amvertexes[line->v1 - vertexes];
+  fl.b = amvertexes[line->v2 - vertexes];
+
+  if (AM_clipFline(&fl))
+  {
+    AM_drawFline(&fl, color);
+  }
+}
+
+//
+// Color of a linedef on the map, or -1 if it is not drawn.
+//
+static int AM_wallColor(line_t* line)
+{
+  if (cheating || (line->flags & ML_MAPPED))
+  {
+    if ((line->flags & LINE_NEVERSEE) && !cheating)
+    {
+      return -1;
+    }
+    if (!line->backsector)
+    {
+      return WALLCOLORS + lightlev;
+    }
+    if (line->special == 39)
+    {
+      // teleporters
+      return WALLCOLORS + WALLRANGE / 2;
+    }
+    if (line->flags & ML_SECRET) // secret door
+    {
+      if (cheating)
+      {
+        return SECRETWALLCOLORS + lightlev;
+      }
+      return WALLCOLORS + lightlev;
+    }
+    if (line->backsector->floorheight
+        != line->frontsector->floorheight)
+    {
+      return FDWALLCOLORS + lightlev; // floor level change
+    }
+    if (line->backsector->ceilingheight
+        != line->frontsector->ceilingheight)
+    {
+      return CDWALLCOLORS + lightlev; // ceiling level change
+    }
+    if (cheating)
+    {
+      return TSWALLCOLORS + lightlev;
+    }
+  }
+  else if (plr->powers[POWER_TYPE_ALLMAP])
+  {
+    if (!(line->flags & LINE_NEVERSEE))
+    {
+      return GRAYS + 3;
+    }
+  }
+  return -1;
+}
+
+static void AM_drawWall(line_t* line)
+{
+  int color;
+
+  color = AM_wallColor(line);
+  if (color >= 0)
+  {
+    AM_drawWallLine(line, color);
+  }
+}
+
 //
 // Determines visible lines, draws them.
 // This is LineDef based, not LineSeg based.
 //
 void AM_drawWalls(void)
 {
-  int i;
-  static mline_t l;
+  int   i, j;
+  int   x, y;
+  int   x0, x1, y0, y1;
+  int*  cell;
+  uint32_t  bits;
 
-  for (i = 0; i < numlines; i++)
+  if (!amgrid)
+  {
+    AM_buildGrid();
+  }
+
+  if (m_x != amtransformkey[0] || m_y != amtransformkey[1]
+      || m_x2 != amtransformkey[2] || m_y2 != amtransformkey[3]
+      || scale_mtof != amtransformkey[4] || f_h != amtransformkey[5])
+  {
+    amtransformed = false;
+    amtransformkey[0] = m_x;
+    amtransformkey[1] = m_y;
+    amtransformkey[2] = m_x2;
+    amtransformkey[3] = m_y2;
+    amtransformkey[4] = scale_mtof;
+    amtransformkey[5] = f_h;
+  }
+
+  x0 = AM_gridCell(m_x, amgridx, amgridwidth);
+  x1 = AM_gridCell(m_x2, amgridx, amgridwidth);
+  y0 = AM_gridCell(m_y, amgridy, amgridheight);
+  y1 = AM_gridCell(m_y2, amgridy, amgridheight);
+
+  if ((x1 - x0 + 1) * (y1 - y0 + 1) * 2 >= amgridwidth * amgridheight)
   {
-    l.a.x = lines[i].v1->x;
-    l.a.y = lines[i].v1->y;
-    l.b.x = lines[i].v2->x;
-    l.b.y = lines[i].v2->y;
-    if (cheating || (lines[i].flags & ML_MAPPED))
+    // Most of the map is in view, where marking
+    //  costs more than the trivial reject it saves.
+    if (!amtransformed)
     {
-      if ((lines[i].flags & LINE_NEVERSEE) && !cheating)
-      {
-        continue;
-      }
-      if (!lines[i].backsector)
+      for (i = 0; i < numvertexes; i++)
       {
-        AM_drawMline(&l, WALLCOLORS + lightlev);
+        amvertexes[i].x = CXMTOF(vertexes[i].x);
+        amvertexes[i].y = CYMTOF(vertexes[i].y);
       }
-      else
+      amtransformed = true;
+    }
+
+    for (i = 0; i < numlines; i++)
+    {
+      AM_drawWall(&lines[i]);
+    }
+    return;
+  }
+
+  memset(amvisible, 0, (numlines + 31) / 32 * sizeof(uint32_t));
+
+  for (y = y0; y <= y1; y++)
+    for (x = x0; x <= x1; x++)
+    {
+      cell = &amgrid[y * amgridwidth + x];
+      for (j = cell[0]; j < cell[1]; j++)
       {
-        if (lines[i].special == 39)
-        {
-          // teleporters
-          AM_drawMline(&l, WALLCOLORS + WALLRANGE / 2);
-        }
-        else if (lines[i].flags & ML_SECRET) // secret door
-        {
-          if (cheating)
-          {
-            AM_drawMline(&l, SECRETWALLCOLORS + lightlev);
-          }
-          else
-          {
-            AM_drawMline(&l, WALLCOLORS + lightlev);
-          }
-        }
-        else if (lines[i].backsector->floorheight
-                 != lines[i].frontsector->floorheight)
-        {
-          AM_drawMline(&l, FDWALLCOLORS + lightlev); // floor level change
-        }
-        else if (lines[i].backsector->ceilingheight
-                 != lines[i].frontsector->ceilingheight)
-        {
-          AM_drawMline(&l, CDWALLCOLORS + lightlev); // ceiling level change
-        }
-        else if (cheating)
-        {
-          AM_drawMline(&l, TSWALLCOLORS + lightlev);
-        }
+        i = amgridlines[j];
+        amvisible[i >> 5] |= 1u << (i & 31);
       }
     }
-    else if (plr->powers[POWER_TYPE_ALLMAP])
+
+  // The same window marks the same lines,
+  //  so their vertexes are still good.
+  if (!amtransformed)
+  {
+    for (i = 0; i < numlines; i += 32)
     {
-      if (!(lines[i].flags & LINE_NEVERSEE))
+      for (bits = amvisible[i >> 5]; bits; bits &= bits - 1)
       {
-        AM_drawMline(&l, GRAYS + 3);
+        AM_transformLine(&lines[i + __builtin_ctz(bits)]);
       }
     }
+    amtransformed = true;
+  }
+
+  for (i = 0; i < numlines; i += 32)
+  {
+    for (bits = amvisible[i >> 5]; bits; bits &= bits - 1)
+    {
+      AM_drawWall(&lines[i + __builtin_ctz(bits)]);
+    }
   }
 }
 
@@ -1475,13 +1788,15 @@ void AM_drawMarks(void)
     {
       //      w = SHORT(marknums[i]->width);
       //      h = SHORT(marknums[i]->height);
-      w = 5; // because something's wrong with the wad, i guess
-      h = 6; // because something's wrong with the wad, i guess
+      w = V_ScaleX (5); // because something's wrong with the wad, i guess
+      h = V_ScaleY (6); // because something's wrong with the wad, i guess
       fx = CXMTOF(markpoints[i].x);
       fy = CYMTOF(markpoints[i].y);
       if (fx >= f_x && fx <= f_w - w && fy >= f_y && fy <= f_h - h)
       {
-        V_DrawPatch(fx, fy, FB, marknums[i]);
+        // Patches are placed in 320x200 coordinates.
+        V_DrawPatch(fx * ORIGWIDTH / SCREENWIDTH,
+                    fy * ORIGHEIGHT / SCREENHEIGHT, FB, marknums[i]);
       }
     }
   }
@@ -47,6 +47,7 @@
 #include "m_argv.h"
 #include "m_misc.h"
 #include "m_menu.h"
+#include "m_profile.h"
 
 #include "i_system.h"
 #include "i_sound.h"
@@ -92,6 +93,9 @@ bool         drone;
 
 bool   singletics = false; // debug flag to cancel adaptiveness
 
+bool   uncapped;   // checkparm of -uncapped
+static int  maxfps;     // frame limiter for -uncapped, 0 = none
+
 
 
 //extern int soundVolume;
@@ -254,7 +258,9 @@ void D_Display (void)
     }
     if (automapactive)
     {
+      PROFILE_START (PROF_AUTOMAP);
       AM_Drawer ();
+      PROFILE_STOP (PROF_AUTOMAP);
     }
     if (wipe || (viewheight != 200 && fullscreen) )
     {
@@ -264,7 +270,9 @@ void D_Display (void)
     {
       redrawsbar = true;  // just put away the help screen
     }
+    PROFILE_START (PROF_STATUSBAR);
     ST_Drawer (viewheight == 200, redrawsbar );
+    PROFILE_STOP (PROF_STATUSBAR);
     fullscreen = viewheight == 200;
     break;
 
@@ -292,7 +300,9 @@ void D_Display (void)
 
   if (gamestate == GAME_STATE_LEVEL && gametic)
   {
+    PROFILE_START (PROF_HUD);
     HU_Drawer ();
+    PROFILE_STOP (PROF_HUD);
   }
 
   // clean up border stuff
@@ -309,7 +319,7 @@ void D_Display (void)
   }
 
   // see if the border needs to be updated to the screen
-  if (gamestate == GAME_STATE_LEVEL && !automapactive && scaledviewwidth != 320)
+  if (gamestate == GAME_STATE_LEVEL && !automapactive && scaledviewwidth != SCREENWIDTH)
   {
     if (menuactive || menuactivestate || !viewactivestate)
     {
@@ -337,10 +347,11 @@ void D_Display (void)
     }
     else
     {
-      y = viewwindowy + 4;
+      y = viewwindowy * ORIGHEIGHT / SCREENHEIGHT + 4;
     }
-    V_DrawPatch(viewwindowx + (scaledviewwidth - 68) / 2,
-                y, 0, W_CacheLumpName ("M_PAUSE", PU_CACHE));
+    // The view window is in screen pixels, patches in 320x200.
+    V_DrawPatch((viewwindowx + scaledviewwidth / 2) * ORIGWIDTH / SCREENWIDTH
+                - 34, y, 0, W_CacheLumpName ("M_PAUSE", PU_CACHE));
   }
 
 
@@ -348,11 +359,17 @@ void D_Display (void)
   M_Drawer ();          // menu is drawn even on top of everything
   NetUpdate ();         // send out any new accumulation
 
+  if (profiling)
+  {
+    M_ProfileDrawer ();
+  }
 
   // normal update
   if (!wipe)
   {
+    PROFILE_START (PROF_FINISHUPDATE);
     I_FinishUpdate ();              // page flip or blit buffer
+    PROFILE_STOP (PROF_FINISHUPDATE);
     return;
   }
 
@@ -363,24 +380,81 @@ void D_Display (void)
 
   do
   {
-    do
+    if (headless)
+    {
+      // One tic per frame, so frame checksums don't depend on timing.
+      tics = 1;
+    }
+    else
     {
-      nowtime = I_GetTime ();
-      tics = nowtime - wipestart;
+      do
+      {
+        nowtime = I_GetTime ();
+        tics = nowtime - wipestart;
+      }
+      while (!tics);
+      wipestart = nowtime;
     }
-    while (!tics);
-    wipestart = nowtime;
     done = wipe_ScreenWipe(wipe_Melt
                            , 0, 0, SCREENWIDTH, SCREENHEIGHT, tics);
     I_UpdateNoBlit ();
     M_Drawer ();                            // menu is drawn even on top of wipes
+    PROFILE_START (PROF_FINISHUPDATE);
     I_FinishUpdate ();                      // page flip or blit buffer
+    PROFILE_STOP (PROF_FINISHUPDATE);
   }
   while (!done);
 }
 
 
 
+//
+// D_LimitFrameRate
+// Sleeps off the rest of the frame when -maxfps is given.
+//
+static void D_LimitFrameRate (void)
+{
+  static int64_t  nextframe;
+  int64_t         now;
+
+  now = I_GetTimeUS ();
+  if (nextframe > now)
+  {
+    I_SleepUS ((int)(nextframe - now));
+  }
+  else if (now - nextframe > 1000000 / maxfps)
+  {
+    // Fell behind; don't try to catch up with a burst of frames.
+    nextframe = now;
+  }
+  nextframe += 1000000 / maxfps;
+}
+
+
+
+//
+// D_SetInterpolation
+// The clock can roll into the next tic before TryRunTics has run it;
+// hold the current tic then rather than jump back to the previous one.
+//
+static void D_SetInterpolation (void)
+{
+  static int      lastgametic = -1;
+  static fixed_t  lastfrac;
+  fixed_t         frac;
+
+  frac = ((I_GetTime () % ticdup) * FRACUNIT + I_GetTimeFrac ()) / ticdup;
+  if (gametic == lastgametic && frac < lastfrac)
+  {
+    frac = FRACUNIT;
+  }
+  lastgametic = gametic;
+  lastfrac = frac;
+  interpfrac = frac;
+}
+
+
+
 //
 //  D_DoomLoop
 //
@@ -401,6 +475,19 @@ void D_DoomLoop (void)
     debugfile = fopen (filename, "w");
   }
 
+  if (M_CheckParm ("-uncapped"))
+  {
+    int p;
+
+    uncapped = true;
+    p = M_CheckParm ("-maxfps");
+    if (p && p < myargc - 1)
+    {
+      maxfps = atoi (myargv[p + 1]);
+    }
+  }
+
+  M_ProfileInit ();
   I_InitGraphics ();
 
   while (1)
@@ -430,8 +517,31 @@ void D_DoomLoop (void)
 
     S_UpdateSounds (players[consoleplayer].mo);// move positional sounds
 
+    // How far between the last two tics this frame is drawn.
+    // The first tic of a level has nothing to interpolate from.
+    if (uncapped && !singletics
+        && gamestate == GAME_STATE_LEVEL && leveltime > 1)
+    {
+      D_SetInterpolation ();
+    }
+    else
+    {
+      interpfrac = FRACUNIT;
+    }
+
     // Update display, next frame, with current state.
+    PROFILE_START (PROF_FRAME);
     D_Display ();
+    PROFILE_STOP (PROF_FRAME);
+    if (profiling)
+    {
+      M_ProfileEndFrame ();
+    }
+
+    if (uncapped && maxfps > 0)
+    {
+      D_LimitFrameRate ();
+    }
 
     // Sound mixing for the buffer is snychronous.
     I_UpdateSound();
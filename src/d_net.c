@@ -749,6 +749,12 @@ void TryRunTics (void)
 
   if (counts < 1)
   {
+    // An uncapped display draws another interpolated frame
+    //  instead of waiting for the next tic.
+    if (uncapped)
+    {
+      return;
+    }
     counts = 1;
   }
 
@@ -153,6 +153,9 @@ typedef struct player_s
   // True if secret level has been done.
   bool   didsecret;
 
+  // viewz at the start of the tic, for uncapped rendering.
+  fixed_t   oldviewz;
+
 } player_t;
 
 
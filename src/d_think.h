@@ -51,11 +51,9 @@ typedef union
 typedef actionf_t  think_t;
 
 
-// Doubly linked list of actors.
+// Head of every actor; they are kept in run order by P_AddThinker.
 typedef struct thinker_s
 {
-  struct thinker_s* prev;
-  struct thinker_s* next;
   think_t   function;
 
 } thinker_t;
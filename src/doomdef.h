@@ -80,24 +80,22 @@ typedef enum
 
 //
 // For resize of screen, at start of game.
-// It will not work dynamically, see visplanes.
+// Drawing of status bar, menues etc. is tied
+//  to the scale implied by the graphics, so all
+//  of that is laid out in the original 320x200
+//  and scaled up to the screen by v_video.c.
 //
-#define BASE_WIDTH    320
-
-// It is educational but futile to change this
-//  scaling e.g. to 2. Drawing of status bar,
-//  menues etc. is tied to the scale implied
-//  by the graphics.
-#define SCREEN_MUL    1
-#define INV_ASPECT_RATIO  0.625 // 0.75, ideally
-
-// Defines suck. C sucks.
-// C++ might sucks for OOP, but it sure is a better C.
-// So there.
-#define SCREENWIDTH  320
-//SCREEN_MUL*BASE_WIDTH //320
-#define SCREENHEIGHT 200
-//(int)(SCREEN_MUL*BASE_WIDTH*INV_ASPECT_RATIO) //200
+#define ORIGWIDTH   320
+#define ORIGHEIGHT  200
+
+// The real screen, set with -width and -height.
+// The refresh draws the view at this size.
+extern  int   SCREENWIDTH;
+extern  int   SCREENHEIGHT;
+
+// Visplanes keep screen rows in shorts.
+#define MAXSCREENWIDTH  4096
+#define MAXSCREENHEIGHT 3072
 
 
 
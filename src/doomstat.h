@@ -238,6 +238,9 @@ extern  int             mouseSensitivity;
 // debug flag to cancel adaptiveness
 extern  bool         singletics;
 
+// render between tics, interpolating positions (-uncapped)
+extern  bool         uncapped;
+
 extern  int             bodyqueslot;
 
 
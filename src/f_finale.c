@@ -270,6 +270,7 @@ void F_TextWrite (void)
 {
   uint8_t* src;
   uint8_t* dest;
+  uint8_t* row;
 
   int   x, y, w;
   int   count;
@@ -282,17 +283,14 @@ void F_TextWrite (void)
   src = W_CacheLumpName ( finaleflat , PU_CACHE);
   dest = screens[0];
 
+  // The flat is scaled like the text drawn over it.
   for (y = 0 ; y < SCREENHEIGHT ; y++)
   {
-    for (x = 0 ; x < SCREENWIDTH / 64 ; x++)
-    {
-      memcpy (dest, src + ((y & 63) << 6), 64);
-      dest += 64;
-    }
-    if (SCREENWIDTH & 63)
+    row = src + (((y * ORIGHEIGHT / SCREENHEIGHT) & 63) << 6);
+
+    for (x = 0 ; x < SCREENWIDTH ; x++)
     {
-      memcpy (dest, src + ((y & 63) << 6), SCREENWIDTH & 63);
-      dest += (SCREENWIDTH & 63);
+      *dest++ = row[(x * ORIGWIDTH / SCREENWIDTH) & 63];
     }
   }
 
@@ -330,7 +328,7 @@ void F_TextWrite (void)
     }
 
     w = SHORT (hu_font[c]->width);
-    if (cx + w > SCREENWIDTH)
+    if (cx + w > ORIGWIDTH)
     {
       break;
     }
@@ -644,7 +642,6 @@ void F_CastPrint (char* text)
 //
 // F_CastDrawer
 //
-void V_DrawPatchFlipped (int x, int y, int scrn, patch_t* patch);
 
 void F_CastDrawer (void)
 {
@@ -679,6 +676,8 @@ void F_CastDrawer (void)
 
 //
 // F_DrawPatchCol
+// Draws patch column col into screen column x,
+//  scaled to the screen height.
 //
 void
 F_DrawPatchCol
@@ -690,7 +689,8 @@ F_DrawPatchCol
   uint8_t* source;
   uint8_t* dest;
   uint8_t* desttop;
-  int   count;
+  int   y;
+  int   bottom;
 
   column = (column_t*)((uint8_t*)patch + LONG(patch->columnofs[col]));
   desttop = screens[0] + x;
@@ -699,12 +699,13 @@ F_DrawPatchCol
   while (column->topdelta != 0xff )
   {
     source = (uint8_t*)column + 3;
-    dest = desttop + column->topdelta * SCREENWIDTH;
-    count = column->length;
+    y = V_ScaleY (column->topdelta);
+    bottom = V_ScaleY (column->topdelta + column->length);
+    dest = desttop + y * SCREENWIDTH;
 
-    while (count--)
+    for ( ; y < bottom ; y++)
     {
-      *dest = *source++;
+      *dest = source[y * ORIGHEIGHT / SCREENHEIGHT - column->topdelta];
       dest += SCREENWIDTH;
     }
     column = (column_t*)(  (uint8_t*)column + column->length + 4 );
@@ -719,6 +720,7 @@ void F_BunnyScroll (void)
 {
   int   scrolled;
   int   x;
+  int   col;
   patch_t*  p1;
   patch_t*  p2;
   char  name[10];
@@ -742,13 +744,15 @@ void F_BunnyScroll (void)
 
   for ( x = 0 ; x < SCREENWIDTH ; x++)
   {
-    if (x + scrolled < 320)
+    col = x * ORIGWIDTH / SCREENWIDTH + scrolled;
+
+    if (col < 320)
     {
-      F_DrawPatchCol (x, p1, x + scrolled);
+      F_DrawPatchCol (x, p1, col);
     }
     else
     {
-      F_DrawPatchCol (x, p2, x + scrolled - 320);
+      F_DrawPatchCol (x, p2, col - 320);
     }
   }
 
@@ -758,8 +762,8 @@ void F_BunnyScroll (void)
   }
   if (finalecount < 1180)
   {
-    V_DrawPatch ((SCREENWIDTH - 13 * 8) / 2,
-                 (SCREENHEIGHT - 8 * 8) / 2, 0, W_CacheLumpName ("END0", PU_CACHE));
+    V_DrawPatch ((ORIGWIDTH - 13 * 8) / 2,
+                 (ORIGHEIGHT - 8 * 8) / 2, 0, W_CacheLumpName ("END0", PU_CACHE));
     laststage = 0;
     return;
   }
@@ -776,7 +780,7 @@ void F_BunnyScroll (void)
   }
 
   sprintf (name, "END%i", stage);
-  V_DrawPatch ((SCREENWIDTH - 13 * 8) / 2, (SCREENHEIGHT - 8 * 8) / 2, 0, W_CacheLumpName (name, PU_CACHE));
+  V_DrawPatch ((ORIGWIDTH - 13 * 8) / 2, (ORIGHEIGHT - 8 * 8) / 2, 0, W_CacheLumpName (name, PU_CACHE));
 }
 
 
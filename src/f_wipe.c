@@ -24,7 +24,7 @@
 #include <stdint.h>
 #include <string.h>
 
-#include "z_zone.h"
+#include "m_argv.h"
 #include "i_video.h"
 #include "v_video.h"
 #include "m_random.h"
@@ -44,106 +44,251 @@ static uint8_t*  wipe_scr_start;
 static uint8_t*  wipe_scr_end;
 static uint8_t*  wipe_scr;
 
+// The melt moves two pixel wide columns down the screen,
+//  y[i] rows so far (y<0 => not ready to scroll yet);
+//  a call redraws column i from row redraw[i] down.
+static int   y[MAXSCREENWIDTH];
+static int   redraw[MAXSCREENWIDTH / 2];
 
-void
-wipe_shittyColMajorXform
-( short*  array,
-  int   width,
-  int   height )
+
+//
+// Kernels.
+// The crossfade moves every pixel of the screen ticks
+//  steps towards the end screen, returning false when
+//  all of them are there already.
+// The melt redraws the columns of the screen a row at a
+//  time, from the row-major start and end screens, starting
+//  at firstrow. Row r of a column is the end screen above
+//  y[i], and start screen row r - y[i] from there down.
+//
+static bool (*xformkernel) (uint8_t* w, const uint8_t* e,
+                            int count, int ticks);
+static void (*meltkernel) (int width, int height, int firstrow);
+
+static bool
+wipe_xformC
+( uint8_t*  w,
+  const uint8_t*  e,
+  int   count,
+  int   ticks )
 {
-  int   x;
-  int   y;
-  short*  dest;
+  bool changed;
+  int   up;
+  int   down;
 
-  dest = (short*) Z_Malloc(width * height * 2, PU_STATIC, 0);
+  changed = false;
 
-  for (y = 0; y < height; y++)
-    for (x = 0; x < width; x++)
-    {
-      dest[x * height + y] = array[y * width + x];
-    }
+  for ( ; count > 0; count--)
+  {
+    down = *w - ticks;
+    up = *w + ticks;
 
-  memcpy(array, dest, width * height * 2);
+    changed |= *w != *e;
+    *w = down > *e ? down : up < *e ? up : *e;
 
-  Z_Free(dest);
+    w++;
+    e++;
+  }
 
+  return changed;
 }
 
-int
-wipe_initColorXForm
+// Columns [i, end) of row row, in shorts.
+static inline void
+wipe_meltSpan
+( int   row,
+  int   i,
+  int   end,
+  int   width )
+{
+  short*  d;
+  const short*  s;
+  const short*  e;
+
+  d = (short*)wipe_scr + row * width;
+  s = (const short*)wipe_scr_start;
+  e = (const short*)wipe_scr_end + row * width;
+
+  for ( ; i < end; i++)
+  {
+    if (row >= redraw[i])
+    {
+      d[i] = row < y[i] ? e[i] : s[(row - y[i]) * width + i];
+    }
+  }
+}
+
+static void
+wipe_meltC
 ( int width,
   int height,
-  int ticks )
+  int firstrow )
 {
-  memcpy(wipe_scr, wipe_scr_start, width * height);
-  return 0;
+  int row;
+
+  for (row = firstrow; row < height; row++)
+  {
+    wipe_meltSpan(row, 0, width, width);
+  }
 }
 
-int
-wipe_doColorXForm
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define WIPE_X86
+#include <immintrin.h>
+
+// Saturated steps, so ticks is capped at a byte:
+//  min (max (w - ticks, e), w + ticks).
+__attribute__((target("avx2")))
+static bool
+wipe_xformAVX2
+( uint8_t*  w,
+  const uint8_t*  e,
+  int   count,
+  int   ticks )
+{
+  __m256i step;
+  __m256i wv;
+  __m256i ev;
+  __m256i diff;
+
+  step = _mm256_set1_epi8(ticks > 255 ? 255 : ticks);
+  diff = _mm256_setzero_si256();
+
+  for ( ; count >= 32; count -= 32)
+  {
+    wv = _mm256_loadu_si256((const __m256i*) w);
+    ev = _mm256_loadu_si256((const __m256i*) e);
+
+    diff = _mm256_or_si256(diff, _mm256_xor_si256(wv, ev));
+    _mm256_storeu_si256((__m256i*) w,
+                        _mm256_min_epu8(_mm256_max_epu8(_mm256_subs_epu8(wv, step), ev),
+                                        _mm256_adds_epu8(wv, step)));
+    w += 32;
+    e += 32;
+  }
+
+  return wipe_xformC(w, e, count, ticks)
+         || !_mm256_testz_si256(diff, diff);
+}
+
+// Eight columns at a time, gathering the start screen
+//  pixels, which sit on a different row for each column.
+// The last eight columns are left to the C loop, so the
+//  four byte gathers never read past the start screen.
+__attribute__((target("avx2")))
+static void
+wipe_meltAVX2
 ( int width,
   int height,
-  int ticks )
+  int firstrow )
 {
-  bool changed;
-  uint8_t* w;
-  uint8_t* e;
-  int   newval;
+  int   row;
+  int   i;
+  short*  d;
+  const short*  e;
+  __m256i lanes;
+  __m256i yv;
+  __m256i write;
+  __m256i start;
+  __m256i index;
+  __m256i pixels;
 
-  changed = false;
-  w = wipe_scr;
-  e = wipe_scr_end;
+  lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
 
-  while (w != wipe_scr + width * height)
+  for (row = firstrow; row < height; row++)
   {
-    if (*w != *e)
+    d = (short*)wipe_scr + row * width;
+    e = (const short*)wipe_scr_end + row * width;
+
+    for (i = 0; i + 8 < width; i += 8)
     {
-      if (*w > *e)
-      {
-        newval = *w - ticks;
-        if (newval < *e)
-        {
-          *w = *e;
-        }
-        else
-        {
-          *w = newval;
-        }
-        changed = true;
-      }
-      else if (*w < *e)
+      write = _mm256_cmpgt_epi32(_mm256_set1_epi32(row + 1),
+                                 _mm256_loadu_si256((const __m256i*) &redraw[i]));
+
+      if (_mm256_testz_si256(write, write))
       {
-        newval = *w + ticks;
-        if (newval > *e)
-        {
-          *w = *e;
-        }
-        else
-        {
-          *w = newval;
-        }
-        changed = true;
+        continue;
       }
+
+      yv = _mm256_loadu_si256((const __m256i*) &y[i]);
+      start = _mm256_and_si256(_mm256_cmpgt_epi32(_mm256_set1_epi32(row + 1), yv),
+                               write);
+
+      // (row - y) * width + i, in shorts.
+      index = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_sub_epi32(_mm256_set1_epi32(row), yv),
+                                                  _mm256_set1_epi32(width)),
+                               _mm256_add_epi32(_mm256_set1_epi32(i), lanes));
+
+      pixels = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*) &e[i]));
+      pixels = _mm256_mask_i32gather_epi32(pixels, (const int*) wipe_scr_start,
+                                           index, start, 2);
+
+      // Keep the columns not moved by this call.
+      pixels = _mm256_blendv_epi8(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*) &d[i])),
+                                  pixels, write);
+
+      pixels = _mm256_and_si256(pixels, _mm256_set1_epi32(0xffff));
+      pixels = _mm256_permute4x64_epi64(_mm256_packus_epi32(pixels, pixels), 0x08);
+      _mm_storeu_si128((__m128i*) &d[i], _mm256_castsi256_si128(pixels));
     }
-    w++;
-    e++;
+
+    wipe_meltSpan(row, i, width, width);
   }
+}
+#endif
 
-  return !changed;
+//
+// wipe_initKernels
+// Picks the kernels for this CPU, -nosimd forces the C ones.
+//
+static void wipe_initKernels(void)
+{
+  xformkernel = wipe_xformC;
+  meltkernel = wipe_meltC;
 
+#ifdef WIPE_X86
+  if (!M_CheckParm("-nosimd"))
+  {
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2"))
+    {
+      xformkernel = wipe_xformAVX2;
+      meltkernel = wipe_meltAVX2;
+    }
+  }
+#endif
 }
 
+
 int
-wipe_exitColorXForm
+wipe_initColorXForm
 ( int width,
   int height,
   int ticks )
 {
+  memcpy(wipe_scr, wipe_scr_start, width * height);
   return 0;
 }
 
+int
+wipe_doColorXForm
+( int width,
+  int height,
+  int ticks )
+{
+  return !xformkernel(wipe_scr, wipe_scr_end, width * height, ticks);
+}
+
+int
+wipe_exitColorXForm
+( int width,
+  int height,
+  int ticks )
+{
+  return 0;
+}
 
-static int* y;
 
 int
 wipe_initMelt
@@ -156,14 +301,8 @@ wipe_initMelt
   // copy start screen to main screen
   memcpy(wipe_scr, wipe_scr_start, width * height);
 
-  // makes this wipe faster (in theory)
-  // to have stuff in column-major format
-  wipe_shittyColMajorXform((short*)wipe_scr_start, width / 2, height);
-  wipe_shittyColMajorXform((short*)wipe_scr_end, width / 2, height);
-
   // setup initial column positions
   // (y<0 => not ready to scroll yet)
-  y = (int*) Z_Malloc(width * sizeof(int), PU_STATIC, 0);
   y[0] = -(M_Random() % 16);
   for (i = 1; i < width; i++)
   {
@@ -189,16 +328,19 @@ wipe_doMelt
   int ticks )
 {
   int   i;
-  int   j;
   int   dy;
-  int   idx;
-
-  short*  s;
-  short*  d;
+  int   firstrow;
   bool done = true;
 
   width /= 2;
 
+  for (i = 0; i < width; i++)
+  {
+    redraw[i] = height;
+  }
+
+  // Move the columns, then draw where they ended up;
+  //  what a tick leaves above a column stays put.
   while (ticks--)
   {
     for (i = 0; i < width; i++)
@@ -215,28 +357,30 @@ wipe_doMelt
         {
           dy = height - y[i];
         }
-        s = &((short*)wipe_scr_end)[i * height + y[i]];
-        d = &((short*)wipe_scr)[y[i] * width + i];
-        idx = 0;
-        for (j = dy; j; j--)
+        if (redraw[i] == height)
         {
-          d[idx] = *(s++);
-          idx += width;
+          redraw[i] = y[i];
         }
         y[i] += dy;
-        s = &((short*)wipe_scr_start)[i * height];
-        d = &((short*)wipe_scr)[y[i] * width + i];
-        idx = 0;
-        for (j = height - y[i]; j; j--)
-        {
-          d[idx] = *(s++);
-          idx += width;
-        }
         done = false;
       }
     }
   }
 
+  if (!done)
+  {
+    firstrow = height;
+    for (i = 0; i < width; i++)
+    {
+      if (redraw[i] < firstrow)
+      {
+        firstrow = redraw[i];
+      }
+    }
+
+    meltkernel(width, height, firstrow);
+  }
+
   return done;
 
 }
@@ -247,7 +391,6 @@ wipe_exitMelt
   int height,
   int ticks )
 {
-  Z_Free(y);
   return 0;
 }
 
@@ -294,6 +437,11 @@ wipe_ScreenWipe
 
   void V_MarkRect(int, int, int, int);
 
+  if (!meltkernel)
+  {
+    wipe_initKernels();
+  }
+
   // initial stuff
   if (!go)
   {
@@ -673,6 +673,13 @@ void G_Ticker (void)
   int   buf;
   ticcmd_t* cmd;
 
+  // Done before reborns and even when paused,
+  //  so a frozen world is drawn still.
+  if (uncapped && gamestate == GAME_STATE_LEVEL)
+  {
+    P_SaveOldPositions ();
+  }
+
   // do player reborns if needed
   for (i = 0 ; i < MAXPLAYERS ; i++)
     if (playeringame[i] && players[i].playerstate == PST_REBORN)
@@ -1310,6 +1317,11 @@ void G_LoadGame (char* name)
 
 #define VERSIONSIZE   16
 
+// Savegames copy mobj_t and player_t whole, so they carry their
+//  own version, bumped whenever those layouts change.
+// VERSION is recorded in demos as well and stays put.
+#define SAVEGAMEVERSION 2
+
 
 void G_DoLoadGame (void)
 {
@@ -1324,7 +1336,7 @@ void G_DoLoadGame (void)
 
   // skip the description field
   memset (vcheck, 0, sizeof(vcheck));
-  sprintf (vcheck, "version %i", VERSION);
+  sprintf (vcheck, "savegame %i", SAVEGAMEVERSION);
   if (strcmp((const char*) save_p, vcheck))
   {
     return;  // bad version
@@ -1403,7 +1415,7 @@ void G_DoSaveGame (void)
   memcpy (save_p, description, SAVESTRINGSIZE);
   save_p += SAVESTRINGSIZE;
   memset (name2, 0, sizeof(name2));
-  sprintf (name2, "version %i", VERSION);
+  sprintf (name2, "savegame %i", SAVEGAMEVERSION);
   memcpy (save_p, name2, VERSIONSIZE);
   save_p += VERSIONSIZE;
 
@@ -1807,6 +1819,7 @@ bool G_CheckDemoStatus (void)
   if (timingdemo)
   {
     endtime = I_GetTime ();
+    R_PrintPeaks ();
     I_Error ("timed %i gametics in %i realtics", gametic
              , endtime - starttime);
   }
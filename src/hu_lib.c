@@ -118,7 +118,7 @@ HUlib_drawTextLine
         && c <= '_')
     {
       w = SHORT(l->f[c - l->sc]->width);
-      if (x + w > SCREENWIDTH)
+      if (x + w > ORIGWIDTH)
       {
         break;
       }
@@ -128,7 +128,7 @@ HUlib_drawTextLine
     else
     {
       x += 4;
-      if (x >= SCREENWIDTH)
+      if (x >= ORIGWIDTH)
       {
         break;
       }
@@ -137,7 +137,7 @@ HUlib_drawTextLine
 
   // draw the cursor if requested
   if (drawcursor
-      && x + SHORT(l->f['_' - l->sc]->width) <= SCREENWIDTH)
+      && x + SHORT(l->f['_' - l->sc]->width) <= ORIGWIDTH)
   {
     V_DrawPatch(x, l->y, FG, l->f['_' - l->sc]);
   }
@@ -158,8 +158,11 @@ void HUlib_eraseTextLine(hu_textline_t* l)
   if (!automapactive &&
       viewwindowx && l->needsupdate)
   {
+    // The line is laid out in 320x200, the view in screen pixels.
     lh = SHORT(l->f[0]->height) + 1;
-    for (y = l->y, yoffset = y * SCREENWIDTH ; y < l->y + lh ; y++, yoffset += SCREENWIDTH)
+    for (y = V_ScaleY(l->y), yoffset = y * SCREENWIDTH ;
+         y < V_ScaleY(l->y + lh) ;
+         y++, yoffset += SCREENWIDTH)
     {
       if (y < viewwindowy || y >= viewwindowy + viewheight)
       {
@@ -26,7 +26,12 @@
 #include <stdarg.h>
 #include <string.h>
 
+#include <time.h>
 #include <sys/time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
 #include <unistd.h>
 
 #include "doomdef.h"
@@ -36,6 +41,7 @@
 
 #include "d_net.h"
 #include "g_game.h"
+#include "r_main.h"
 
 #include "i_system.h"
 
@@ -75,6 +81,50 @@ int  I_GetTime (void)
   return newtics;
 }
 
+//
+// I_GetTimeFrac
+// returns how far the clock is into the current tic, 0 to FRACUNIT-1
+//
+fixed_t I_GetTimeFrac (void)
+{
+  struct timeval  tp;
+
+  gettimeofday(&tp, NULL);
+  return (fixed_t)((int64_t)(tp.tv_usec * TICRATE % 1000000) * FRACUNIT / 1000000);
+}
+
+//
+// I_GetTimeUS
+// returns a monotonic clock in microseconds, for the frame limiter
+//
+int64_t I_GetTimeUS (void)
+{
+  struct timeval  tp;
+
+  gettimeofday(&tp, NULL);
+  return (int64_t)tp.tv_sec * 1000000 + tp.tv_usec;
+}
+
+//
+// I_GetTimeNS
+// returns a monotonic clock in nanoseconds, for the profiler
+//
+int64_t I_GetTimeNS (void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void I_SleepUS (int usec)
+{
+  if (usec > 0)
+  {
+    usleep (usec);
+  }
+}
+
 
 
 //
@@ -96,9 +146,49 @@ void I_Quit (void)
   I_ShutdownMusic();
   M_SaveDefaults ();
   I_ShutdownGraphics();
+  R_PrintPeaks ();
   exit(0);
 }
 
+/**
+ * Maps a whole file read-only. Returns NULL if it can't be opened
+ * or mapped, otherwise stores its size in size.
+ */
+void* I_MapFile(const char* name, int* size)
+{
+  struct stat fileinfo;
+  void* base;
+  int handle = open(name, O_RDONLY);
+
+  if (handle == -1)
+  {
+    return NULL;
+  }
+
+  if (fstat(handle, &fileinfo) == -1 || fileinfo.st_size <= 0
+      || fileinfo.st_size > INT32_MAX)
+  {
+    close(handle);
+    return NULL;
+  }
+
+  base = mmap(NULL, fileinfo.st_size, PROT_READ, MAP_SHARED, handle, 0);
+  close(handle);
+
+  if (base == MAP_FAILED)
+  {
+    return NULL;
+  }
+
+  *size = fileinfo.st_size;
+  return base;
+}
+
+void I_UnmapFile(void* base, int size)
+{
+  munmap(base, size);
+}
+
 void I_WaitVBL(int count)
 {
 #ifdef SGI
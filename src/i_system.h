@@ -23,6 +23,7 @@
 
 #include "d_ticcmd.h"
 #include "d_event.h"
+#include "m_fixed.h"
 
 // Called by DoomMain.
 void I_Init (void);
@@ -31,6 +32,14 @@ void I_Init (void);
 // returns current time in tics.
 int I_GetTime (void);
 
+// Fraction of the current tic that has elapsed,
+//  for interpolating uncapped frames.
+fixed_t I_GetTimeFrac (void);
+
+int64_t I_GetTimeUS (void);
+int64_t I_GetTimeNS (void);
+void I_SleepUS (int usec);
+
 
 //
 // Called by D_DoomLoop,
@@ -69,4 +78,8 @@ void I_Tactile (int on, int off, int total);
 
 void I_Error(const char* format, ...);
 
+// Read-only file mapping, for data caches.
+void* I_MapFile(const char* name, int* size);
+void I_UnmapFile(void* base, int size);
+
 #endif /* !__I_SYSTEM__ */
@@ -0,0 +1,104 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+// $Log:$
+//
+// DESCRIPTION:
+//  Worker threads on top of SDL threads.
+//
+//-----------------------------------------------------------------------------
+#include <stdint.h>
+
+#include <SDL/SDL.h>
+
+#include "i_system.h"
+#include "i_thread.h"
+
+static SDL_Thread* workers[MAXWORKERS];
+static SDL_sem* startsem[MAXWORKERS];
+static SDL_sem* donesem;
+static int numworkers = 1;
+
+static void (*currentjob)(int index);
+
+static int I_WorkerThread(void* data)
+{
+  const int index = (int) (intptr_t) data;
+
+  for (;;)
+  {
+    SDL_SemWait(startsem[index]);
+    currentjob(index);
+    SDL_SemPost(donesem);
+  }
+
+  return 0;
+}
+
+/**
+ * Starts worker threads until there are count - 1 of them.
+ */
+static void I_StartWorkers(int count)
+{
+  if (count > MAXWORKERS)
+  {
+    I_Error("I_RunParallel: %i workers requested, limit is %i",
+            count, MAXWORKERS);
+  }
+
+  if (!donesem)
+  {
+    donesem = SDL_CreateSemaphore(0);
+  }
+
+  for (; numworkers < count; ++numworkers)
+  {
+    startsem[numworkers] = SDL_CreateSemaphore(0);
+    workers[numworkers] = SDL_CreateThread(
+      I_WorkerThread,
+      (void*) (intptr_t) numworkers
+    );
+
+    if (!workers[numworkers])
+    {
+      I_Error("SDL_CreateThread: %s", SDL_GetError());
+    }
+  }
+}
+
+void I_RunParallel(int count, void (*job)(int index))
+{
+  int i;
+
+  if (count > numworkers)
+  {
+    I_StartWorkers(count);
+  }
+
+  currentjob = job;
+
+  for (i = 1; i < count; ++i)
+  {
+    SDL_SemPost(startsem[i]);
+  }
+
+  job(0);
+
+  for (i = 1; i < count; ++i)
+  {
+    SDL_SemWait(donesem);
+  }
+}
@@ -0,0 +1,34 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+// DESCRIPTION:
+//  System specific interface stuff, worker threads.
+//
+//-----------------------------------------------------------------------------
+#ifndef __I_THREAD__
+#define __I_THREAD__
+
+// Upper limit for the count passed to I_RunParallel.
+#define MAXWORKERS  64
+
+/**
+ * Calls job(0) to job(count - 1) concurrently and returns when all of them
+ * have finished. job(0) runs on the calling thread, the others on worker
+ * threads which are started on first use and kept around.
+ */
+void I_RunParallel(int count, void (*job)(int index));
+
+#endif /* !__I_THREAD__ */
@@ -21,18 +21,44 @@
 //
 //-----------------------------------------------------------------------------
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <ctype.h>
 
 #include <SDL/SDL.h>
 
+#include "doomdef.h"
+#include "doomstat.h"
 #include "d_main.h"
+#include "m_argv.h"
 #include "i_system.h"
+#include "i_video.h"
 #include "v_video.h"
 
 static bool initialized = false;
 static SDL_Surface* window;
 static SDL_Color palette_out[256];
 
+// Render into screens[0] only, without SDL (-headless).
+bool headless = false;
+
+// Per frame checksums of the presented screen (-framecrc <file>).
+static FILE* framecrcfile;
+static int framecount;
+
+// Upload all of screens[0] on the next I_FinishUpdate,
+//  not just the dirty rectangles.
+static bool fullupdate = true;
+
+// 32 bit output through a palette lookup (-truecolor).
+static bool truecolor;
+static uint32_t truecolormap[256];
+
+// Expands count palette indices to truecolormap pixels.
+static void (*expandkernel)(uint32_t* dest, const uint8_t* src, int count);
+
 /**
  * Translates SDL key symbol.
  */
@@ -158,9 +184,18 @@ static int translate_key(SDL_keysym* key)
 
 void I_ShutdownGraphics()
 {
+  if (framecrcfile)
+  {
+    fclose(framecrcfile);
+    framecrcfile = NULL;
+  }
+
   if (initialized)
   {
-    SDL_QuitSubSystem(SDL_INIT_VIDEO);
+    if (!headless)
+    {
+      SDL_QuitSubSystem(SDL_INIT_VIDEO);
+    }
     initialized = false;
   }
 }
@@ -234,7 +269,8 @@ static void I_GetEvent()
 //
 void I_StartTic()
 {
-  if (initialized)
+  // No input without a window; demos and netgames still play.
+  if (initialized && !headless)
   {
     I_GetEvent();
   }
@@ -248,21 +284,244 @@ void I_UpdateNoBlit (void)
   // what is this?
 }
 
+/**
+ * Writes the FNV-1a hash of the frame and its palette, so two runs of the
+ * same demo can be compared frame by frame.
+ */
+static void I_WriteFrameChecksum()
+{
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  const uint8_t* bytes = screens[0];
+  const int size = SCREENWIDTH * SCREENHEIGHT;
+
+  for (int i = 0; i < size; ++i)
+  {
+    hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+  }
+  bytes = (const uint8_t*) palette_out;
+  for (int i = 0; i < (int) sizeof(palette_out); ++i)
+  {
+    hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+  }
+
+  fprintf(framecrcfile, "%d %d %016llx\n",
+          framecount, gametic, (unsigned long long) hash);
+}
+
+/**
+ * Expands palette indices through truecolormap, eight at a time.
+ */
+static void I_ExpandC(uint32_t* dest, const uint8_t* src, int count)
+{
+  const uint32_t* map = truecolormap;
+
+  for (; count >= 8; count -= 8)
+  {
+    dest[0] = map[src[0]];
+    dest[1] = map[src[1]];
+    dest[2] = map[src[2]];
+    dest[3] = map[src[3]];
+    dest[4] = map[src[4]];
+    dest[5] = map[src[5]];
+    dest[6] = map[src[6]];
+    dest[7] = map[src[7]];
+    dest += 8;
+    src += 8;
+  }
+  for (; count > 0; --count)
+  {
+    *dest++ = map[*src++];
+  }
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define EXPAND_X86
+#include <immintrin.h>
+
+/**
+ * AVX2: widens eight indices to 32 bits and gathers their colors.
+ */
+__attribute__((target("avx2")))
+static void I_ExpandAVX2(uint32_t* dest, const uint8_t* src, int count)
+{
+  const int* map = (const int*) truecolormap;
+  __m256i index;
+
+  for (; count >= 8; count -= 8)
+  {
+    index = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*) src));
+    _mm256_storeu_si256((__m256i*) dest,
+                        _mm256_i32gather_epi32(map, index, 4));
+    dest += 8;
+    src += 8;
+  }
+  for (; count > 0; --count)
+  {
+    *dest++ = truecolormap[*src++];
+  }
+}
+#endif
+
+/**
+ * Picks the expansion kernel for this CPU, -nosimd forces the C one.
+ */
+static void I_InitExpandKernel()
+{
+  expandkernel = I_ExpandC;
+
+#ifdef EXPAND_X86
+  if (!M_CheckParm("-nosimd"))
+  {
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2"))
+    {
+      expandkernel = I_ExpandAVX2;
+    }
+  }
+#endif
+}
+
+/**
+ * Makes palette the surface's colors; for a 32 bit surface that means
+ * the lookup the frames are expanded through.
+ */
+static void I_SetColors(SDL_Color* palette)
+{
+  int i;
+
+  if (!truecolor)
+  {
+    SDL_SetColors(window, palette, 0, 256);
+    return;
+  }
+
+  for (i = 0; i < 256; ++i)
+  {
+    truecolormap[i] = SDL_MapRGB(window->format,
+                                 palette[i].r,
+                                 palette[i].g,
+                                 palette[i].b);
+  }
+}
+
+/**
+ * Copies a run of a frame's pixels into the surface.
+ */
+static void I_CopyPixels(uint8_t* dest, const uint8_t* src, int count)
+{
+  if (truecolor)
+  {
+    expandkernel((uint32_t*) dest, src, count);
+  }
+  else
+  {
+    memcpy(dest, src, count);
+  }
+}
+
+/**
+ * Uploads the whole of screens[0].
+ */
+static void I_UpdateFullScreen()
+{
+  const uint8_t* src = screens[0];
+  uint8_t* dest;
+  int y;
+
+  SDL_LockSurface(window);
+  dest = window->pixels;
+  for (y = 0; y < SCREENHEIGHT; ++y)
+  {
+    I_CopyPixels(dest, src, SCREENWIDTH);
+    src += SCREENWIDTH;
+    dest += window->pitch;
+  }
+  SDL_UnlockSurface(window);
+
+  SDL_Flip(window);
+}
+
+/**
+ * Uploads the parts of screens[0] drawn since the last frame.
+ */
+static void I_UpdateDirtyRects()
+{
+  SDL_Rect sdlrects[MAXDIRTYRECTS];
+  const dirtyrect_t* r;
+  const uint8_t* src;
+  uint8_t* dest;
+  int width;
+  int i;
+  int y;
+
+  SDL_LockSurface(window);
+  for (i = 0; i < numdirtyrects; ++i)
+  {
+    r = &dirtyrects[i];
+    width = r->x2 - r->x1;
+    src = screens[0] + r->y1 * SCREENWIDTH + r->x1;
+    dest = (uint8_t*) window->pixels + r->y1 * window->pitch
+           + r->x1 * window->format->BytesPerPixel;
+    for (y = r->y1; y < r->y2; ++y)
+    {
+      I_CopyPixels(dest, src, width);
+      src += SCREENWIDTH;
+      dest += window->pitch;
+    }
+
+    sdlrects[i].x = r->x1;
+    sdlrects[i].y = r->y1;
+    sdlrects[i].w = width;
+    sdlrects[i].h = r->y2 - r->y1;
+  }
+  SDL_UnlockSurface(window);
+
+  SDL_UpdateRects(window, numdirtyrects, sdlrects);
+}
+
 //
 // I_FinishUpdate
 //
 void I_FinishUpdate()
 {
-  if (!initialized || !(SDL_GetAppState() & SDL_APPACTIVE))
+  if (!initialized)
   {
     return;
   }
 
-  SDL_LockSurface(window);
-  memcpy(window->pixels, screens[0], SCREENWIDTH * SCREENHEIGHT);
-  SDL_UnlockSurface(window);
+  if (framecrcfile)
+  {
+    I_WriteFrameChecksum();
+  }
+  ++framecount;
 
-  SDL_Flip(window);
+  if (headless)
+  {
+    V_ClearDirtyRects();
+    return;
+  }
+
+  // The surface misses what is drawn while minimized.
+  if (!(SDL_GetAppState() & SDL_APPACTIVE))
+  {
+    fullupdate = true;
+    V_ClearDirtyRects();
+    return;
+  }
+
+  // A page flipped surface has to be drawn whole.
+  if (fullupdate || (window->flags & SDL_HWSURFACE
+                     && window->flags & SDL_DOUBLEBUF))
+  {
+    I_UpdateFullScreen();
+  }
+  else if (numdirtyrects)
+  {
+    I_UpdateDirtyRects();
+  }
+  fullupdate = false;
+  V_ClearDirtyRects();
 }
 
 //
@@ -287,16 +546,40 @@ void I_SetPalette(const uint8_t* palette)
     palette_out[i].b = *palette++;
   }
 
-  SDL_SetColors(window, palette_out, 0, 256);
+  if (!headless)
+  {
+    I_SetColors(palette_out);
+    fullupdate = true;
+  }
 }
 
 void I_InitGraphics()
 {
+  int p;
+
   if (initialized)
   {
     return;
   }
 
+  p = M_CheckParm("-framecrc");
+  if (p && p < myargc - 1)
+  {
+    framecrcfile = fopen(myargv[p + 1], "w");
+    if (!framecrcfile)
+    {
+      I_Error("I_InitGraphics: can't write %s", myargv[p + 1]);
+    }
+  }
+
+  if (M_CheckParm("-headless"))
+  {
+    headless = true;
+    screens[0] = (unsigned char*) malloc(SCREENWIDTH * SCREENHEIGHT);
+    initialized = true;
+    return;
+  }
+
   // Needs SDL_INIT_TIMER?
   if (SDL_Init(SDL_INIT_VIDEO))
   {
@@ -310,11 +593,19 @@ void I_InitGraphics()
   SDL_GL_SetAttribute(SDL_GL_ALPHA_SIZE, 8);
   SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 8);
 
+  // A 32 bit surface skips SDL's 8 bit palette emulation,
+  // which is slow on a 32 bit desktop.
+  truecolor = M_CheckParm("-truecolor") != 0;
+  if (truecolor)
+  {
+    I_InitExpandKernel();
+  }
+
   // Use OpenGL.
   window = SDL_SetVideoMode(
     SCREENWIDTH,
     SCREENHEIGHT,
-    8,
+    truecolor ? 32 : 8,
     SDL_SWSURFACE | SDL_DOUBLEBUF
   );
 
@@ -21,6 +21,9 @@
 #ifndef __I_VIDEO__
 #define __I_VIDEO__
 
+// True when rendering without a window (-headless).
+extern bool headless;
+
 // Called by D_DoomMain,
 // determines the hardware configuration
 // and sets up the video mode
@@ -1362,7 +1362,7 @@ M_WriteText
     }
 
     w = SHORT (hu_font[c]->width);
-    if (cx + w > SCREENWIDTH)
+    if (cx + w > ORIGWIDTH)
     {
       break;
     }
@@ -85,7 +85,7 @@ M_DrawText
     }
 
     w = SHORT (hu_font[c]->width);
-    if (x + w > SCREENWIDTH)
+    if (x + w > ORIGWIDTH)
     {
       break;
     }
@@ -0,0 +1,306 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+// $Log:$
+//
+// DESCRIPTION:
+//  Frame profiler.
+//  Each stage sums its wall time over the frame, since a stage
+//   can run more than once (I_FinishUpdate during a wipe).
+//  -profile draws a running average over the view,
+//  -profilelog <file> writes every frame as CSV, or as JSON
+//   when the file name ends in .json.
+//
+//-----------------------------------------------------------------------------
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+
+#include <SDL_endian.h>
+
+#include "doomdef.h"
+#include "doomstat.h"
+
+#include "i_system.h"
+#include "m_argv.h"
+#include "m_swap.h"
+#include "v_video.h"
+#include "v_patch.h"
+#include "hu_stuff.h"
+
+#include "m_profile.h"
+
+// Frames averaged for the overlay.
+#define PROFILEAVERAGE  35
+
+bool    profiling;
+int     profcounters[NUMPROFCOUNTERS];
+
+static bool     profileoverlay;
+static FILE*    profilelog;
+static bool     profilejson;
+static int      profileframe;
+
+static int64_t  stagestart[NUMPROFSTAGES];
+static int64_t  stagetime[NUMPROFSTAGES];
+
+// Sums over the current PROFILEAVERAGE frames,
+//  and the averages of the last ones for the overlay.
+static int64_t  stagesum[NUMPROFSTAGES];
+static int64_t  countersum[NUMPROFCOUNTERS];
+static int      sumframes;
+static double   stageavg[NUMPROFSTAGES];
+static int      counteravg[NUMPROFCOUNTERS];
+
+static const char* stagenames[NUMPROFSTAGES] =
+{
+  "frame", "view", "bsp", "planes", "masked", "drawqueue",
+  "statusbar", "hud", "automap", "finishupdate"
+};
+
+static const char* counternames[NUMPROFCOUNTERS] =
+{
+  "nodes", "segs", "visplanes", "vissprites", "columns", "spans",
+  "patchhits", "patchmisses", "patchkb"
+};
+
+extern patch_t* hu_font[HU_FONTSIZE];
+
+
+//
+// M_ProfileClose
+// Finishes the log when the program exits, through I_Quit or I_Error.
+//
+static void M_ProfileClose (void)
+{
+  if (!profilelog)
+  {
+    return;
+  }
+
+  if (profilejson)
+  {
+    fprintf (profilelog, "\n]\n");
+  }
+  fclose (profilelog);
+  profilelog = NULL;
+}
+
+
+//
+// M_ProfileInit
+//
+void M_ProfileInit (void)
+{
+  int         p;
+  int         i;
+  const char* name;
+  size_t      len;
+
+  profileoverlay = M_CheckParm ("-profile") != 0;
+
+  p = M_CheckParm ("-profilelog");
+  if (p && p < myargc - 1)
+  {
+    name = myargv[p + 1];
+    profilelog = fopen (name, "w");
+    if (!profilelog)
+    {
+      I_Error ("M_ProfileInit: can't write %s", name);
+    }
+
+    len = strlen (name);
+    profilejson = len > 5 && !strcmp (name + len - 5, ".json");
+
+    if (profilejson)
+    {
+      fprintf (profilelog, "[");
+    }
+    else
+    {
+      fprintf (profilelog, "frame,gametic");
+      for (i = 0 ; i < NUMPROFSTAGES ; i++)
+      {
+        fprintf (profilelog, ",%s_us", stagenames[i]);
+      }
+      for (i = 0 ; i < NUMPROFCOUNTERS ; i++)
+      {
+        fprintf (profilelog, ",%s", counternames[i]);
+      }
+      fprintf (profilelog, "\n");
+    }
+    atexit (M_ProfileClose);
+  }
+
+  profiling = profileoverlay || profilelog;
+}
+
+
+void M_ProfileStart (profstage_t stage)
+{
+  stagestart[stage] = I_GetTimeNS ();
+}
+
+
+void M_ProfileStop (profstage_t stage)
+{
+  stagetime[stage] += I_GetTimeNS () - stagestart[stage];
+}
+
+
+//
+// M_ProfileLogFrame
+//
+static void M_ProfileLogFrame (void)
+{
+  int i;
+
+  if (profilejson)
+  {
+    fprintf (profilelog, "%s\n{\"frame\":%d,\"gametic\":%d",
+             profileframe ? "," : "", profileframe, gametic);
+    for (i = 0 ; i < NUMPROFSTAGES ; i++)
+    {
+      fprintf (profilelog, ",\"%s_us\":%.1f",
+               stagenames[i], stagetime[i] / 1000.0);
+    }
+    for (i = 0 ; i < NUMPROFCOUNTERS ; i++)
+    {
+      fprintf (profilelog, ",\"%s\":%d", counternames[i], profcounters[i]);
+    }
+    fprintf (profilelog, "}");
+  }
+  else
+  {
+    fprintf (profilelog, "%d,%d", profileframe, gametic);
+    for (i = 0 ; i < NUMPROFSTAGES ; i++)
+    {
+      fprintf (profilelog, ",%.1f", stagetime[i] / 1000.0);
+    }
+    for (i = 0 ; i < NUMPROFCOUNTERS ; i++)
+    {
+      fprintf (profilelog, ",%d", profcounters[i]);
+    }
+    fprintf (profilelog, "\n");
+  }
+}
+
+
+//
+// M_ProfileEndFrame
+//
+void M_ProfileEndFrame (void)
+{
+  int i;
+
+  if (profiling)
+  {
+    profcounters[PROF_PATCHKB] = V_PatchCacheSize () / 1024;
+  }
+
+  if (profilelog)
+  {
+    M_ProfileLogFrame ();
+  }
+
+  for (i = 0 ; i < NUMPROFSTAGES ; i++)
+  {
+    stagesum[i] += stagetime[i];
+    stagetime[i] = 0;
+  }
+  for (i = 0 ; i < NUMPROFCOUNTERS ; i++)
+  {
+    countersum[i] += profcounters[i];
+    profcounters[i] = 0;
+  }
+
+  if (++sumframes == PROFILEAVERAGE)
+  {
+    for (i = 0 ; i < NUMPROFSTAGES ; i++)
+    {
+      stageavg[i] = stagesum[i] / (PROFILEAVERAGE * 1000000.0);
+      stagesum[i] = 0;
+    }
+    for (i = 0 ; i < NUMPROFCOUNTERS ; i++)
+    {
+      counteravg[i] = countersum[i] / PROFILEAVERAGE;
+      countersum[i] = 0;
+    }
+    sumframes = 0;
+  }
+
+  profileframe++;
+}
+
+
+//
+// M_ProfileText
+// Like M_WriteText, with tighter lines.
+//
+static void M_ProfileText (int x, int y, const char* string)
+{
+  int c;
+  int w;
+
+  for ( ; *string ; string++)
+  {
+    c = toupper (*string) - HU_FONTSTART;
+    if (c < 0 || c >= HU_FONTSIZE)
+    {
+      x += 4;
+      continue;
+    }
+
+    w = SHORT (hu_font[c]->width);
+    if (x + w > ORIGWIDTH)
+    {
+      break;
+    }
+    V_DrawPatch (x, y, 0, hu_font[c]);
+    x += w;
+  }
+}
+
+
+//
+// M_ProfileDrawer
+//
+void M_ProfileDrawer (void)
+{
+  char  line[40];
+  int   y;
+  int   i;
+
+  if (!profileoverlay)
+  {
+    return;
+  }
+
+  y = 10;
+  for (i = 0 ; i < NUMPROFSTAGES ; i++, y += 8)
+  {
+    snprintf (line, sizeof(line), "%s %.2f", stagenames[i], stageavg[i]);
+    M_ProfileText (ORIGWIDTH - 124, y, line);
+  }
+  for (i = 0 ; i < NUMPROFCOUNTERS ; i++, y += 8)
+  {
+    snprintf (line, sizeof(line), "%s %d", counternames[i], counteravg[i]);
+    M_ProfileText (ORIGWIDTH - 124, y, line);
+  }
+}
@@ -0,0 +1,93 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+// DESCRIPTION:
+//  Per stage frame timings and refresh counters.
+//
+//-----------------------------------------------------------------------------
+#ifndef __M_PROFILE__
+#define __M_PROFILE__
+
+//
+// Timed stages of a frame; they nest, e.g. BSP is part of VIEW
+//  and VIEW is part of FRAME.
+//
+typedef enum
+{
+  PROF_FRAME,   // D_Display
+  PROF_VIEW,    // R_RenderPlayerView
+  PROF_BSP,     // R_RenderBSPNode
+  PROF_PLANES,  // R_DrawPlanes
+  PROF_MASKED,  // R_DrawMasked
+  PROF_DRAWQUEUE, // R_FlushDrawQueue, the threaded draws
+  PROF_STATUSBAR, // ST_Drawer
+  PROF_HUD,   // HU_Drawer
+  PROF_AUTOMAP, // AM_Drawer
+  PROF_FINISHUPDATE, // I_FinishUpdate
+  NUMPROFSTAGES
+} profstage_t;
+
+//
+// Per frame counts.
+//
+typedef enum
+{
+  PROF_NODES,   // BSP nodes visited
+  PROF_SEGS,    // drawsegs stored
+  PROF_VISPLANES,
+  PROF_VISSPRITES,
+  PROF_COLUMNS, // column draws issued
+  PROF_SPANS,   // span draws issued
+  PROF_PATCHHITS, // patch cache lookups
+  PROF_PATCHMISSES, // patches converted
+  PROF_PATCHKB, // patch cache size, taken at the end of the frame
+  NUMPROFCOUNTERS
+} profcounter_t;
+
+// Set by -profile (overlay) or -profilelog <file>.
+extern bool   profiling;
+
+// Bumped through PROFILE_COUNT, cleared every frame
+//  by M_ProfileEndFrame.
+extern int    profcounters[NUMPROFCOUNTERS];
+
+// Reads -profile and -profilelog, called by D_DoomLoop.
+void M_ProfileInit (void);
+
+void M_ProfileStart (profstage_t stage);
+void M_ProfileStop (profstage_t stage);
+
+// Logs the frame and clears the counters, called by D_DoomLoop.
+void M_ProfileEndFrame (void);
+
+// Draws the overlay, called by D_Display.
+void M_ProfileDrawer (void);
+
+#define PROFILE_START(stage) \
+  do { if (profiling) M_ProfileStart (stage); } while (0)
+#define PROFILE_STOP(stage) \
+  do { if (profiling) M_ProfileStop (stage); } while (0)
+
+// Only while profiling, nothing else clears the counters.
+#define PROFILE_COUNT(counter, n) \
+  do { if (profiling) profcounters[counter] += (n); } while (0)
+
+#endif
+//-----------------------------------------------------------------------------
+//
+// $Log:$
+//
+//-----------------------------------------------------------------------------
@@ -281,7 +281,7 @@ EV_DoDoor
 
     // new door thinker
     rtn = 1;
-    door = Z_Malloc (sizeof(*door), PU_LEVSPEC, 0);
+    door = P_AllocateThinker (THINKER_POOL_MOVER);
     P_AddThinker (&door->thinker);
     sec->specialdata = door;
 
@@ -464,7 +464,7 @@ EV_VerticalDoor
 
 
   // new door thinker
-  door = Z_Malloc (sizeof(*door), PU_LEVSPEC, 0);
+  door = P_AllocateThinker (THINKER_POOL_MOVER);
   P_AddThinker (&door->thinker);
   sec->specialdata = door;
   door->thinker.function.acp1 = (actionf_p1) T_VerticalDoor;
@@ -514,7 +514,7 @@ void P_SpawnDoorCloseIn30 (sector_t* sec)
 {
   vldoor_t* door;
 
-  door = Z_Malloc ( sizeof(*door), PU_LEVSPEC, 0);
+  door = P_AllocateThinker (THINKER_POOL_MOVER);
 
   P_AddThinker (&door->thinker);
 
@@ -539,7 +539,7 @@ P_SpawnDoorRaiseIn5Mins
 {
   vldoor_t* door;
 
-  door = Z_Malloc ( sizeof(*door), PU_LEVSPEC, 0);
+  door = P_AllocateThinker (THINKER_POOL_MOVER);
 
   P_AddThinker (&door->thinker);
 
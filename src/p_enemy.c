@@ -654,13 +654,15 @@ void A_KeenDie (mobj_t* mo)
   thinker_t*  th;
   mobj_t* mo2;
   line_t  junk;
+  int   i;
 
   A_Fall (mo);
 
   // scan the remaining thinkers
   // to see if all Keens are dead
-  for (th = thinkercap.next ; th != &thinkercap ; th = th->next)
+  for (i = 0 ; i < numthinkers ; i++)
   {
+    th = thinkers[i];
     if (th->function.acp1 != (actionf_p1)P_MobjThinker)
     {
       continue;
@@ -1648,19 +1650,19 @@ A_PainShootSkull
   int   prestep;
   int   count;
   thinker_t*  currentthinker;
+  int   i;
 
   // count total number of skull currently on the level
   count = 0;
 
-  currentthinker = thinkercap.next;
-  while (currentthinker != &thinkercap)
+  for (i = 0 ; i < numthinkers ; i++)
   {
+    currentthinker = thinkers[i];
     if (   (currentthinker->function.acp1 == (actionf_p1)P_MobjThinker)
            && ((mobj_t*)currentthinker)->type == MT_SKULL)
     {
       count++;
     }
-    currentthinker = currentthinker->next;
   }
 
   // if there are allready 20 skulls on the level,
@@ -1913,8 +1915,9 @@ void A_BossDeath (mobj_t* mo)
 
   // scan the remaining thinkers to see
   // if all bosses are dead
-  for (th = thinkercap.next ; th != &thinkercap ; th = th->next)
+  for (i = 0 ; i < numthinkers ; i++)
   {
+    th = thinkers[i];
     if (th->function.acp1 != (actionf_p1)P_MobjThinker)
     {
       continue;
@@ -2040,16 +2043,15 @@ void A_BrainAwake (mobj_t* mo)
 {
   thinker_t*  thinker;
   mobj_t* m;
+  int   i;
 
   // find all the target spots
   numbraintargets = 0;
   braintargeton = 0;
 
-  thinker = thinkercap.next;
-  for (thinker = thinkercap.next ;
-       thinker != &thinkercap ;
-       thinker = thinker->next)
+  for (i = 0 ; i < numthinkers ; i++)
   {
+    thinker = thinkers[i];
     if (thinker->function.acp1 != (actionf_p1)P_MobjThinker)
     {
       continue;  // not a mobj
@@ -280,7 +280,7 @@ EV_DoFloor
 
     // new floor thinker
     rtn = 1;
-    floor = Z_Malloc (sizeof(*floor), PU_LEVSPEC, 0);
+    floor = P_AllocateThinker (THINKER_POOL_MOVER);
     P_AddThinker (&floor->thinker);
     sec->specialdata = floor;
     floor->thinker.function.acp1 = (actionf_p1) T_MoveFloor;
@@ -489,7 +489,7 @@ EV_BuildStairs
 
     // new floor thinker
     rtn = 1;
-    floor = Z_Malloc (sizeof(*floor), PU_LEVSPEC, 0);
+    floor = P_AllocateThinker (THINKER_POOL_MOVER);
     P_AddThinker (&floor->thinker);
     sec->specialdata = floor;
     floor->thinker.function.acp1 = (actionf_p1) T_MoveFloor;
@@ -550,7 +550,7 @@ EV_BuildStairs
 
         sec = tsec;
         secnum = newsecnum;
-        floor = Z_Malloc (sizeof(*floor), PU_LEVSPEC, 0);
+        floor = P_AllocateThinker (THINKER_POOL_MOVER);
 
         P_AddThinker (&floor->thinker);
 
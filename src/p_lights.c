@@ -81,7 +81,7 @@ void P_SpawnFireFlicker (sector_t*  sector)
   // Nothing special about it during gameplay.
   sector->special = 0;
 
-  flick = Z_Malloc ( sizeof(*flick), PU_LEVSPEC, 0);
+  flick = P_AllocateThinker (THINKER_POOL_LIGHT);
 
   P_AddThinker (&flick->thinker);
 
@@ -138,7 +138,7 @@ void P_SpawnLightFlash (sector_t* sector)
   // nothing special about it during gameplay
   sector->special = 0;
 
-  flash = Z_Malloc ( sizeof(*flash), PU_LEVSPEC, 0);
+  flash = P_AllocateThinker (THINKER_POOL_LIGHT);
 
   P_AddThinker (&flash->thinker);
 
@@ -197,7 +197,7 @@ P_SpawnStrobeFlash
 {
   strobe_t* flash;
 
-  flash = Z_Malloc ( sizeof(*flash), PU_LEVSPEC, 0);
+  flash = P_AllocateThinker (THINKER_POOL_LIGHT);
 
   P_AddThinker (&flash->thinker);
 
@@ -370,7 +370,7 @@ void P_SpawnGlowingLight(sector_t*  sector)
 {
   glow_t* g;
 
-  g = Z_Malloc( sizeof(*g), PU_LEVSPEC, 0);
+  g = P_AllocateThinker (THINKER_POOL_LIGHT);
 
   P_AddThinker(&g->thinker);
 
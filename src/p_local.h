@@ -62,13 +62,26 @@
 // P_TICK
 //
 
-// both the head and tail of the thinker list
-extern  thinker_t thinkercap;
+// Every thinker, in the order they were added and run.
+// Removed ones stay, marked, until the end of the tic.
+extern  thinker_t** thinkers;
+extern  int   numthinkers;
+
+// Thinkers of a kind are allocated together, from their own pool.
+typedef enum
+{
+  THINKER_POOL_MOBJ,
+  THINKER_POOL_MOVER, // ceilings, doors, floors, plats
+  THINKER_POOL_LIGHT,
+  NUMTHINKERPOOLS
+} thinkerpool_t;
 
 
 void P_InitThinkers (void);
+void* P_AllocateThinker (thinkerpool_t pool);
 void P_AddThinker (thinker_t* thinker);
 void P_RemoveThinker (thinker_t* thinker);
+void P_FreeRemovedThinkers (void);
 
 
 //
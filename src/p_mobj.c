@@ -555,7 +555,7 @@ P_SpawnMobj
   state_t*  st;
   mobjinfo_t* info;
 
-  mobj = Z_Malloc (sizeof(*mobj), PU_LEVEL, NULL);
+  mobj = P_AllocateThinker (THINKER_POOL_MOBJ);
   memset (mobj, 0, sizeof (*mobj));
   info = &mobjinfo[type];
 
@@ -602,6 +602,11 @@ P_SpawnMobj
     mobj->z = z;
   }
 
+  mobj->oldx = mobj->x;
+  mobj->oldy = mobj->y;
+  mobj->oldz = mobj->z;
+  mobj->oldangle = mobj->angle;
+
   mobj->thinker.function.acp1 = (actionf_p1)P_MobjThinker;
 
   P_AddThinker (&mobj->thinker);
@@ -777,6 +782,7 @@ void P_SpawnPlayer (MapThing* mthing)
   p->extralight = 0;
   p->fixedcolormap = 0;
   p->viewheight = VIEWHEIGHT;
+  p->oldviewz = mobj->z + VIEWHEIGHT;
 
   // setup gun psprite
   P_SetupPsprites (p);
@@ -273,6 +273,13 @@ typedef struct mobj_s
   // Thing being chased/attacked for tracers.
   struct mobj_s*  tracer;
 
+  // Position at the start of the tic, for uncapped rendering.
+  // Never read by the playsim.
+  fixed_t   oldx;
+  fixed_t   oldy;
+  fixed_t   oldz;
+  angle_t   oldangle;
+
 } mobj_t;
 
 
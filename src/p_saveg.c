@@ -191,6 +191,8 @@ void P_UnArchiveWorld (void)
   {
     sec->floorheight = *get++ << FRACBITS;
     sec->ceilingheight = *get++ << FRACBITS;
+    sec->oldfloorheight = sec->floorheight;
+    sec->oldceilingheight = sec->ceilingheight;
     sec->floorpic = *get++;
     sec->ceilingpic = *get++;
     sec->lightlevel = *get++;
@@ -246,10 +248,12 @@ void P_ArchiveThinkers (void)
 {
   thinker_t*    th;
   mobj_t*   mobj;
+  int     i;
 
   // save off the current thinkers
-  for (th = thinkercap.next ; th != &thinkercap ; th = th->next)
+  for (i = 0 ; i < numthinkers ; i++)
   {
+    th = thinkers[i];
     if (th->function.acp1 == (actionf_p1)P_MobjThinker)
     {
       *save_p++ = tc_mobj;
@@ -282,14 +286,13 @@ void P_UnArchiveThinkers (void)
 {
   uint8_t    tclass;
   thinker_t*    currentthinker;
-  thinker_t*    next;
   mobj_t*   mobj;
+  int     i;
 
   // remove all the current thinkers
-  currentthinker = thinkercap.next;
-  while (currentthinker != &thinkercap)
+  for (i = 0 ; i < numthinkers ; i++)
   {
-    next = currentthinker->next;
+    currentthinker = thinkers[i];
 
     if (currentthinker->function.acp1 == (actionf_p1)P_MobjThinker)
     {
@@ -297,12 +300,10 @@ void P_UnArchiveThinkers (void)
     }
     else
     {
-      Z_Free (currentthinker);
+      P_RemoveThinker (currentthinker);
     }
-
-    currentthinker = next;
   }
-  P_InitThinkers ();
+  P_FreeRemovedThinkers ();
 
   // read in saved thinkers
   while (1)
@@ -315,7 +316,7 @@ void P_UnArchiveThinkers (void)
 
     case tc_mobj:
       PADSAVEP();
-      mobj = Z_Malloc (sizeof(*mobj), PU_LEVEL, NULL);
+      mobj = P_AllocateThinker (THINKER_POOL_MOBJ);
       memcpy (mobj, save_p, sizeof(*mobj));
       save_p += sizeof(*mobj);
       mobj->state = &states[(int64_t)mobj->state];
@@ -382,10 +383,12 @@ void P_ArchiveSpecials (void)
   strobe_t*   strobe;
   glow_t*   glow;
   int     i;
+  int     n;
 
   // save off the current thinkers
-  for (th = thinkercap.next ; th != &thinkercap ; th = th->next)
+  for (n = 0 ; n < numthinkers ; n++)
   {
+    th = thinkers[n];
     if (th->function.acv == (actionf_v)NULL)
     {
       for (i = 0; i < MAXCEILINGS; i++)
@@ -516,7 +519,7 @@ void P_UnArchiveSpecials (void)
 
     case tc_ceiling:
       PADSAVEP();
-      ceiling = Z_Malloc (sizeof(*ceiling), PU_LEVEL, NULL);
+      ceiling = P_AllocateThinker (THINKER_POOL_MOVER);
       memcpy (ceiling, save_p, sizeof(*ceiling));
       save_p += sizeof(*ceiling);
       ceiling->sector = &sectors[(int64_t)ceiling->sector];
@@ -533,7 +536,7 @@ void P_UnArchiveSpecials (void)
 
     case tc_door:
       PADSAVEP();
-      door = Z_Malloc (sizeof(*door), PU_LEVEL, NULL);
+      door = P_AllocateThinker (THINKER_POOL_MOVER);
       memcpy (door, save_p, sizeof(*door));
       save_p += sizeof(*door);
       door->sector = &sectors[(int64_t)door->sector];
@@ -544,7 +547,7 @@ void P_UnArchiveSpecials (void)
 
     case tc_floor:
       PADSAVEP();
-      floor = Z_Malloc (sizeof(*floor), PU_LEVEL, NULL);
+      floor = P_AllocateThinker (THINKER_POOL_MOVER);
       memcpy (floor, save_p, sizeof(*floor));
       save_p += sizeof(*floor);
       floor->sector = &sectors[(int64_t)floor->sector];
@@ -555,7 +558,7 @@ void P_UnArchiveSpecials (void)
 
     case tc_plat:
       PADSAVEP();
-      plat = Z_Malloc (sizeof(*plat), PU_LEVEL, NULL);
+      plat = P_AllocateThinker (THINKER_POOL_MOVER);
       memcpy (plat, save_p, sizeof(*plat));
       save_p += sizeof(*plat);
       plat->sector = &sectors[(int64_t)plat->sector];
@@ -572,7 +575,7 @@ void P_UnArchiveSpecials (void)
 
     case tc_flash:
       PADSAVEP();
-      flash = Z_Malloc (sizeof(*flash), PU_LEVEL, NULL);
+      flash = P_AllocateThinker (THINKER_POOL_LIGHT);
       memcpy (flash, save_p, sizeof(*flash));
       save_p += sizeof(*flash);
       flash->sector = &sectors[(int64_t)flash->sector];
@@ -582,7 +585,7 @@ void P_UnArchiveSpecials (void)
 
     case tc_strobe:
       PADSAVEP();
-      strobe = Z_Malloc (sizeof(*strobe), PU_LEVEL, NULL);
+      strobe = P_AllocateThinker (THINKER_POOL_LIGHT);
       memcpy (strobe, save_p, sizeof(*strobe));
       save_p += sizeof(*strobe);
       strobe->sector = &sectors[(int64_t)strobe->sector];
@@ -592,7 +595,7 @@ void P_UnArchiveSpecials (void)
 
     case tc_glow:
       PADSAVEP();
-      glow = Z_Malloc (sizeof(*glow), PU_LEVEL, NULL);
+      glow = P_AllocateThinker (THINKER_POOL_LIGHT);
       memcpy (glow, save_p, sizeof(*glow));
       save_p += sizeof(*glow);
       glow->sector = &sectors[(int64_t)glow->sector];
@@ -44,6 +44,7 @@
 #include "r_defs.h"
 #include "r_main.h"
 #include "r_things.h"
+#include "r_pvs.h"
 #include "p_local.h"
 
 #include "s_sound.h"
@@ -255,6 +256,8 @@ void P_LoadSectors (int lump)
   {
     ss->floorheight = SHORT(ms->floorheight) << FRACBITS;
     ss->ceilingheight = SHORT(ms->ceilingheight) << FRACBITS;
+    ss->oldfloorheight = ss->floorheight;
+    ss->oldceilingheight = ss->ceilingheight;
     ss->floorpic = R_FlatNumForName(ms->floorpic);
     ss->ceilingpic = R_FlatNumForName(ms->ceilingpic);
     ss->lightlevel = SHORT(ms->lightlevel);
@@ -686,6 +689,7 @@ P_SetupLevel
 
   rejectmatrix = W_CacheLumpNum (lumpnum + ML_REJECT, PU_LEVEL);
   P_GroupLines ();
+  R_BuildPVS (lumpnum);
 
   bodyqueslot = 0;
   deathmatch_p = deathmatchstarts;
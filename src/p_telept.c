@@ -51,6 +51,7 @@ EV_Teleport
   mobj_t* thing )
 {
   int   i;
+  int   j;
   int   tag;
   mobj_t* m;
   mobj_t* fog;
@@ -80,11 +81,10 @@ EV_Teleport
   {
     if (sectors[ i ].tag == tag )
     {
-      thinker = thinkercap.next;
-      for (thinker = thinkercap.next;
-           thinker != &thinkercap;
-           thinker = thinker->next)
+      for (j = 0; j < numthinkers; j++)
       {
+        thinker = thinkers[j];
+
         // not a mobj
         if (thinker->function.acp1 != (actionf_p1)P_MobjThinker)
         {
@@ -139,6 +139,16 @@ EV_Teleport
 
         thing->angle = m->angle;
         thing->momx = thing->momy = thing->momz = 0;
+
+        // don't draw the frames in between as a slide across the map
+        thing->oldx = thing->x;
+        thing->oldy = thing->y;
+        thing->oldz = thing->z;
+        thing->oldangle = thing->angle;
+        if (thing->player)
+        {
+          thing->player->oldviewz = thing->player->viewz;
+        }
         return 1;
       }
     }
@@ -21,15 +21,19 @@
 //  Thinker, Ticker.
 //
 //-----------------------------------------------------------------------------
+#include <stdlib.h>
+#include <string.h>
 #include <stdbool.h>
 #include <stdint.h>
 
 #include "z_zone.h"
+#include "i_system.h"
 #include "m_fixed.h"
 #include "doomdef.h"
 #include "p_mobj.h"
 #include "d_player.h"
 #include "r_defs.h"
+#include "r_state.h"
 #include "p_local.h"
 
 #include "doomstat.h"
@@ -39,39 +43,140 @@ int leveltime;
 
 //
 // THINKERS
-// All thinkers should be allocated by Z_Malloc
+// All thinkers should be allocated by P_AllocateThinker
 // so they can be operated on uniformly.
 // The actual structures will vary in size,
 // but the first element must be thinker_t.
 //
+// Each kind gets a pool of equal slots carved out of PU_LEVEL
+// chunks, so the mobjs of a slaughter map lie packed together
+// instead of strewn through the zone between movers and lights.
+// They still run in the order they were added, across kinds,
+// since the order decides who draws which P_Random number.
+//
+
+// Slots per chunk.
+#define THINKERCHUNK  128
+
+// The largest thinker of each pool.
+typedef union
+{
+  ceiling_t   ceiling;
+  vldoor_t    door;
+  floormove_t floor;
+  plat_t      plat;
+} anymover_t;
+
+typedef union
+{
+  fireflicker_t flicker;
+  lightflash_t  flash;
+  strobe_t      strobe;
+  glow_t        glow;
+} anylight_t;
+
+static const int thinkersizes[NUMTHINKERPOOLS] =
+{
+  sizeof(mobj_t),
+  sizeof(anymover_t),
+  sizeof(anylight_t)
+};
+
+//
+// Heads each slot, like memblock_t does a zone block,
+// so the slot is found again without looking at the thinker,
+// which gets memset by P_SpawnMobj and memcpy'd by savegames.
+//
+typedef struct thinkerslot_s
+{
+  struct thinkerslot_s* nextfree;
+  int     pool;
+} thinkerslot_t;
+
+typedef struct
+{
+  thinkerslot_t*  freeslots;
 
+  // rest of the newest chunk, not handed out yet
+  uint8_t*  chunk;
+  int   chunkleft;
+} thinkerpooldata_t;
 
+static thinkerpooldata_t thinkerpools[NUMTHINKERPOOLS];
 
-// Both the head and tail of the thinker list.
-thinker_t thinkercap;
+thinker_t** thinkers;
+int   numthinkers;
+static int  maxthinkers;
 
 
 //
 // P_InitThinkers
+// The pools went with the level's PU_LEVEL blocks.
 //
 void P_InitThinkers (void)
 {
-  thinkercap.prev = thinkercap.next  = &thinkercap;
+  memset (thinkerpools, 0, sizeof(thinkerpools));
+  numthinkers = 0;
 }
 
 
 
 
+//
+// P_AllocateThinker
+// Like Z_Malloc, the thinker is not cleared.
+//
+void* P_AllocateThinker (thinkerpool_t pool)
+{
+  thinkerpooldata_t*  p;
+  thinkerslot_t*  slot;
+  int   size;
+
+  p = &thinkerpools[pool];
+
+  if (p->freeslots)
+  {
+    slot = p->freeslots;
+    p->freeslots = slot->nextfree;
+    return slot + 1;
+  }
+
+  size = sizeof(thinkerslot_t) + ((thinkersizes[pool] + 7) & ~7);
+
+  if (!p->chunkleft)
+  {
+    p->chunk = Z_Malloc (THINKERCHUNK * size, PU_LEVEL, NULL);
+    p->chunkleft = THINKERCHUNK;
+  }
+
+  slot = (thinkerslot_t*)p->chunk;
+  slot->pool = pool;
+  p->chunk += size;
+  p->chunkleft--;
+
+  return slot + 1;
+}
+
+
+
 //
 // P_AddThinker
 // Adds a new thinker at the end of the list.
 //
 void P_AddThinker (thinker_t* thinker)
 {
-  thinkercap.prev->next = thinker;
-  thinker->next = &thinkercap;
-  thinker->prev = thinkercap.prev;
-  thinkercap.prev = thinker;
+  if (numthinkers == maxthinkers)
+  {
+    maxthinkers = maxthinkers ? maxthinkers * 2 : 1024;
+    thinkers = realloc (thinkers, maxthinkers * sizeof(*thinkers));
+
+    if (!thinkers)
+    {
+      I_Error ("P_AddThinker: no memory for %i thinkers", maxthinkers);
+    }
+  }
+
+  thinkers[numthinkers++] = thinker;
 }
 
 
@@ -79,51 +184,108 @@ void P_AddThinker (thinker_t* thinker)
 //
 // P_RemoveThinker
 // Deallocation is lazy -- it will not actually be freed
-// until its thinking turn comes up.
+// until the end of the tic.
 //
 void P_RemoveThinker (thinker_t* thinker)
 {
-  // FIXME: NOP.
   thinker->function.acv = (actionf_v)(-1);
 }
 
 
 
 //
-// P_AllocateThinker
-// Allocates memory and adds a new thinker at the end of the list.
+// P_FreeRemovedThinkers
+// Gives the slots of removed thinkers back to their pools
+// and closes up the list, keeping the rest in order.
 //
-void P_AllocateThinker (thinker_t*  thinker)
+void P_FreeRemovedThinkers (void)
 {
+  thinker_t*  th;
+  thinkerslot_t*  slot;
+  int   i;
+  int   j;
+
+  for (i = j = 0 ; i < numthinkers ; i++)
+  {
+    th = thinkers[i];
+    if (th->function.acv == (actionf_v)(-1))
+    {
+      slot = (thinkerslot_t*)th - 1;
+      slot->nextfree = thinkerpools[slot->pool].freeslots;
+      thinkerpools[slot->pool].freeslots = slot;
+    }
+    else
+    {
+      thinkers[j++] = th;
+    }
+  }
+
+  numthinkers = j;
 }
 
 
 
 //
 // P_RunThinkers
+// Thinkers added on the way, like missiles, run this tic too.
 //
 void P_RunThinkers (void)
 {
   thinker_t*  currentthinker;
+  int   i;
 
-  currentthinker = thinkercap.next;
-  while (currentthinker != &thinkercap)
+  for (i = 0 ; i < numthinkers ; i++)
   {
-    if ( currentthinker->function.acv == (actionf_v)(-1) )
+    currentthinker = thinkers[i];
+    if (currentthinker->function.acv == (actionf_v)(-1))
     {
-      // time to remove it
-      currentthinker->next->prev = currentthinker->prev;
-      currentthinker->prev->next = currentthinker->next;
-      Z_Free (currentthinker);
+      continue;  // freed at the end of the tic
     }
-    else
+
+    if (currentthinker->function.acp1)
     {
-      if (currentthinker->function.acp1)
-      {
-        currentthinker->function.acp1 (currentthinker);
-      }
+      currentthinker->function.acp1 (currentthinker);
     }
-    currentthinker = currentthinker->next;
+  }
+}
+
+
+
+//
+// P_SaveOldPositions
+// Remembers where everything was before the tic runs,
+// so an uncapped display can draw the frames in between.
+//
+void P_SaveOldPositions (void)
+{
+  thinker_t*  th;
+  mobj_t*     mo;
+  sector_t*   sec;
+  int         i;
+
+  for (i = 0 ; i < numthinkers ; i++)
+  {
+    th = thinkers[i];
+    if (th->function.acp1 != (actionf_p1)P_MobjThinker)
+    {
+      continue;
+    }
+    mo = (mobj_t*)th;
+    mo->oldx = mo->x;
+    mo->oldy = mo->y;
+    mo->oldz = mo->z;
+    mo->oldangle = mo->angle;
+  }
+
+  for (i = 0, sec = sectors ; i < numsectors ; i++, sec++)
+  {
+    sec->oldfloorheight = sec->floorheight;
+    sec->oldceilingheight = sec->ceilingheight;
+  }
+
+  for (i = 0 ; i < MAXPLAYERS ; i++)
+  {
+    players[i].oldviewz = players[i].viewz;
   }
 }
 
@@ -162,6 +324,7 @@ void P_Ticker (void)
   P_RunThinkers ();
   P_UpdateSpecials ();
   P_RespawnSpecials ();
+  P_FreeRemovedThinkers ();
 
   // for par times
   leveltime++;
@@ -26,6 +26,9 @@
 // Carries out all thinking of monsters and players.
 void P_Ticker (void);
 
+// Called by G_Ticker before anything moves, when uncapped.
+void P_SaveOldPositions (void);
+
 
 
 #endif
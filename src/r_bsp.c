@@ -29,10 +29,12 @@
 #include "m_bbox.h"
 
 #include "i_system.h"
+#include "m_profile.h"
 
 #include "r_main.h"
 #include "r_plane.h"
 #include "r_things.h"
+#include "r_pvs.h"
 
 // State.
 #include "doomstat.h"
@@ -45,8 +47,11 @@ line_t*   linedef;
 sector_t* frontsector;
 sector_t* backsector;
 
-drawseg_t drawsegs[MAXDRAWSEGS];
+// Grows as needed and keeps its size between frames.
+#define INITDRAWSEGS  256
+drawseg_t*  drawsegs;
 drawseg_t*  ds_p;
+int   maxdrawsegs;
 
 
 void
@@ -66,6 +71,27 @@ void R_ClearDrawSegs (void)
 }
 
 
+//
+// R_GrowDrawSegs
+// Only ds_p points into drawsegs while the BSP is walked.
+//
+void R_GrowDrawSegs (void)
+{
+  int   count;
+
+  count = ds_p - drawsegs;
+  maxdrawsegs = maxdrawsegs ? maxdrawsegs * 2 : INITDRAWSEGS;
+  drawsegs = realloc (drawsegs, maxdrawsegs * sizeof(*drawsegs));
+
+  if (!drawsegs)
+  {
+    I_Error ("R_GrowDrawSegs: no memory for %i drawsegs", maxdrawsegs);
+  }
+
+  ds_p = drawsegs + count;
+}
+
+
 
 //
 // ClipWallSegment
@@ -80,11 +106,13 @@ typedef struct
 } cliprange_t;
 
 
-#define MAXSEGS   32
+// Posts never touch, so a view can not hold more
+//  than one for every other column, plus the two ends.
+#define MAXSEGS   (SCREENWIDTH / 2 + 2)
 
 // newend is one past the last valid seg
 cliprange_t*  newend;
-cliprange_t solidsegs[MAXSEGS];
+cliprange_t*  solidsegs;
 
 
 
@@ -249,6 +277,17 @@ R_ClipPassWallSegment
 //
 void R_ClearClipSegs (void)
 {
+  // MAXSEGS depends on the screen width picked at startup.
+  if (!solidsegs)
+  {
+    solidsegs = malloc (MAXSEGS * sizeof(*solidsegs));
+
+    if (!solidsegs)
+    {
+      I_Error ("R_ClearClipSegs: no memory for clip segs");
+    }
+  }
+
   solidsegs[0].first = -0x7fffffff;
   solidsegs[0].last = -1;
   solidsegs[1].first = viewwidth;
@@ -273,8 +312,8 @@ void R_AddLine (seg_t*  line)
   curline = line;
 
   // OPTIMIZE: quickly reject orthogonal back sides.
-  angle1 = R_PointToAngle (line->v1->x, line->v1->y);
-  angle2 = R_PointToAngle (line->v2->x, line->v2->y);
+  angle1 = R_VertexAngle (line->v1);
+  angle2 = R_VertexAngle (line->v2);
 
   // Clip to view edges.
   // OPTIMIZE: make constant out of 2*clipangle (FIELDOFVIEW).
@@ -606,15 +645,29 @@ void R_RenderBSPNode (int bspnum)
   {
     if (bspnum == -1)
     {
-      R_Subsector (0);
+      bspnum = 0;
     }
     else
     {
-      R_Subsector (bspnum & (~NF_SUBSECTOR));
+      bspnum &= ~NF_SUBSECTOR;
+    }
+
+    // Nothing in it can be seen from here.
+    if (pvsactive && !pvssubsectors[bspnum])
+    {
+      return;
     }
+    R_Subsector (bspnum);
+    return;
+  }
+
+  // Nothing under it can be seen from here.
+  if (pvsactive && !pvsnodes[bspnum])
+  {
     return;
   }
 
+  PROFILE_COUNT (PROF_NODES, 1);
   bsp = &nodes[bspnum];
 
   // Decide which side the view point is on.
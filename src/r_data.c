@@ -33,6 +33,7 @@
 #include "i_system.h"
 #include "z_zone.h"
 
+#include "m_argv.h"
 #include "m_swap.h"
 
 #include "w_wad.h"
@@ -48,6 +49,7 @@
 #include "r_sky.h"
 
 #include "r_data.h"
+#include "r_main.h"
 
 //
 // Graphics.
@@ -154,6 +156,13 @@ uint8_t**      texturecomposite;
 int*    flattranslation;
 int*    texturetranslation;
 
+// -linearflats keeps flats as stored in the WAD,
+//  to compare against the tiled layout.
+bool    linearflats;
+
+// Tiled copies made by R_GetFlat, purgable.
+static uint8_t** tiledflats;
+
 // needed for pre rendering
 fixed_t*  spritewidth;
 fixed_t*  spriteoffset;
@@ -221,80 +230,195 @@ R_DrawColumnInCache
 
 
 //
-// R_GenerateComposite
-// Using the texture definition,
-//  the composite texture is created from the patches,
-//  and each column is cached.
+// COMPOSITE CACHE
+// Columns covered by more than one patch are composited
+//  one at a time, the first time each one is drawn.
+//  A bitmap after the composite, one bit per column of
+//  the texture, marks the columns done.
+// Composites are not purgable, they are kept in a least
+//  recently used list of their own within a byte budget
+//  (-compositecache <kb>), so they are neither purged along
+//  with the lumps nor crowd the lumps out of the zone.
+// Composites used in the current frame are never dropped;
+//  a view that needs more than the budget grows the cache
+//  past it, and the next frame's allocations trim it back.
+// Composites mapped from the texture cache are complete
+//  and outside the zone, they skip all of this.
 //
-void R_GenerateComposite (int texnum)
+// A sixteenth of the zone.
+#define COMPOSITEBUDGET (1024*1024)
+
+static int    compositebudget = COMPOSITEBUDGET;
+static int    compositebytes;
+static bool   compositesmapped;
+
+// Texture numbers, most recently used first, -1 ends.
+static int*   compositenext;
+static int*   compositeprev;
+
+// framecount each composite was last drawn from, -1 if never.
+static int*   compositeframe;
+static int    compositehead = -1;
+static int    compositetail = -1;
+
+
+static int R_CompositeSize (int texnum)
 {
-  uint8_t*   block;
-  texture_t*    texture;
-  texpatch_t*   patch;
-  patch_t*    realpatch;
-  int     x;
-  int     x1;
-  int     x2;
-  int     i;
-  column_t*   patchcol;
-  short*    collump;
-  unsigned short* colofs;
+  return texturecompositesize[texnum] + (textures[texnum]->width + 7) / 8;
+}
 
-  texture = textures[texnum];
 
-  block = Z_Malloc (texturecompositesize[texnum],
-                    PU_STATIC,
-                    &texturecomposite[texnum]);
+static void R_UnlinkComposite (int texnum)
+{
+  if (compositeprev[texnum] >= 0)
+  {
+    compositenext[compositeprev[texnum]] = compositenext[texnum];
+  }
+  else
+  {
+    compositehead = compositenext[texnum];
+  }
 
-  collump = texturecolumnlump[texnum];
-  colofs = texturecolumnofs[texnum];
+  if (compositenext[texnum] >= 0)
+  {
+    compositeprev[compositenext[texnum]] = compositeprev[texnum];
+  }
+  else
+  {
+    compositetail = compositeprev[texnum];
+  }
+}
 
-  // Composite the columns together.
-  patch = texture->patches;
+
+static void R_LinkComposite (int texnum)
+{
+  compositeprev[texnum] = -1;
+  compositenext[texnum] = compositehead;
+
+  if (compositehead >= 0)
+  {
+    compositeprev[compositehead] = texnum;
+  }
+  else
+  {
+    compositetail = texnum;
+  }
+
+  compositehead = texnum;
+}
+
+
+//
+// R_AllocComposite
+// Makes room within the budget, dropping the least
+//  recently used composites, and allocates an empty one.
+// Stops short of the composites drawn this frame, which
+//  are all at the head, so the budget can be overrun.
+//
+static void R_AllocComposite (int texnum)
+{
+  int   size;
+  int   oldest;
+
+  size = R_CompositeSize (texnum);
+
+  while (compositetail >= 0
+         && compositebytes + size > compositebudget
+         && compositeframe[compositetail] != framecount)
+  {
+    oldest = compositetail;
+    R_UnlinkComposite (oldest);
+    compositebytes -= R_CompositeSize (oldest);
+
+    // Not drawn from this frame, so no queued draw still
+    //  points into it. Clears texturecomposite[oldest].
+    Z_Free (texturecomposite[oldest]);
+  }
+
+  Z_Malloc (size, PU_STATIC, &texturecomposite[texnum]);
+  memset (texturecomposite[texnum] + texturecompositesize[texnum],
+          0, size - texturecompositesize[texnum]);
+
+  R_LinkComposite (texnum);
+  compositebytes += size;
+  compositeframe[texnum] = -1;
+}
+
+
+//
+// R_GenerateColumn
+// Draws every patch covering column x of the
+//  texture, in order, into its composite.
+//
+static void R_GenerateColumn (int texnum, int x)
+{
+  uint8_t*      ready;
+  texture_t*    texture;
+  texpatch_t*   patch;
+  patch_t*      realpatch;
+  column_t*     patchcol;
+  int           x1;
+  int           i;
+
+  texture = textures[texnum];
 
   for (i = 0 , patch = texture->patches;
        i < texture->patchcount;
        i++, patch++)
   {
-    realpatch = W_CacheLumpNum (patch->patch, PU_CACHE);
     x1 = patch->originx;
-    x2 = x1 + SHORT(realpatch->width);
 
-    if (x1 < 0)
+    if (x < x1)
     {
-      x = 0;
-    }
-    else
-    {
-      x = x1;
+      continue;
     }
 
-    if (x2 > texture->width)
+    realpatch = W_CacheLumpNum (patch->patch, PU_CACHE);
+
+    if (x >= x1 + SHORT(realpatch->width))
     {
-      x2 = texture->width;
+      continue;
     }
 
-    for ( ; x < x2 ; x++)
-    {
-      // Column does not have multiple patches?
-      if (collump[x] >= 0)
-      {
-        continue;
-      }
+    patchcol = (column_t*)((uint8_t*)realpatch
+                           + LONG(realpatch->columnofs[x - x1]));
+    R_DrawColumnInCache (patchcol,
+                         texturecomposite[texnum]
+                         + texturecolumnofs[texnum][x],
+                         patch->originy,
+                         texture->height);
+  }
 
-      patchcol = (column_t*)((uint8_t*)realpatch
-                             + LONG(realpatch->columnofs[x - x1]));
-      R_DrawColumnInCache (patchcol,
-                           block + colofs[x],
-                           patch->originy,
-                           texture->height);
-    }
+  ready = texturecomposite[texnum] + texturecompositesize[texnum];
+  ready[x >> 3] |= 1 << (x & 7);
+}
+
+
+//
+// R_GenerateComposite
+// Composites every column of the texture not done yet.
+//
+void R_GenerateComposite (int texnum)
+{
+  uint8_t*   ready;
+  short*  collump;
+  int     x;
 
+  if (!texturecomposite[texnum])
+  {
+    R_AllocComposite (texnum);
   }
 
-  // Now that the texture has been built in column cache,
-  //  it is purgable from zone memory.
-  Z_ChangeTag (block, PU_CACHE);
+  collump = texturecolumnlump[texnum];
+  ready = texturecomposite[texnum] + texturecompositesize[texnum];
+
+  for (x = 0 ; x < textures[texnum]->width ; x++)
+  {
+    if (collump[x] < 0 && !(ready[x >> 3] & (1 << (x & 7))))
+    {
+      R_GenerateColumn (texnum, x);
+    }
+  }
 }
 
 
@@ -321,8 +445,10 @@ void R_GenerateLookup (int texnum)
   texturecomposite[texnum] = 0;
 
   texturecompositesize[texnum] = 0;
-  collump = texturecolumnlump[texnum];
-  colofs = texturecolumnofs[texnum];
+  collump = texturecolumnlump[texnum] =
+    Z_Malloc (texture->width * sizeof(*collump), PU_STATIC, NULL);
+  colofs = texturecolumnofs[texnum] =
+    Z_Malloc (texture->width * sizeof(*colofs), PU_STATIC, NULL);
 
   // Now count the number of columns
   //  that are covered by more than one patch.
@@ -401,6 +527,7 @@ R_GetColumn
 {
   int   lump;
   int   ofs;
+  uint8_t*   ready;
 
   col &= texturewidthmask[tex];
   lump = texturecolumnlump[tex][col];
@@ -411,9 +538,27 @@ R_GetColumn
     return (uint8_t*)W_CacheLumpNum(lump, PU_CACHE) + ofs;
   }
 
+  if (compositesmapped)
+  {
+    return texturecomposite[tex] + ofs;
+  }
+
   if (!texturecomposite[tex])
   {
-    R_GenerateComposite (tex);
+    R_AllocComposite (tex);
+  }
+  else if (tex != compositehead)
+  {
+    R_UnlinkComposite (tex);
+    R_LinkComposite (tex);
+  }
+
+  compositeframe[tex] = framecount;
+  ready = texturecomposite[tex] + texturecompositesize[tex];
+
+  if (!(ready[col >> 3] & (1 << (col & 7))))
+  {
+    R_GenerateColumn (tex, col);
   }
 
   return texturecomposite[tex] + ofs;
@@ -422,6 +567,293 @@ R_GetColumn
 
 
 
+//
+// TEXTURE CACHE
+// The column lookups and composites only depend on the
+//  loaded WADs, so they are saved to a file keyed by a
+//  hash of the WAD set. Later runs map that file and point
+//  the lookups and composites straight into it, skipping
+//  R_GenerateLookup and the first-use R_GenerateComposite.
+//
+#define TCACHE_MAGIC    0x43585444    // "DTXC" in little endian.
+#define TCACHE_VERSION  1
+
+typedef struct
+{
+  uint32_t  magic;
+  uint32_t  version;
+  uint64_t  hash;
+  int32_t   numtextures;
+  int32_t   size;
+} tcacheheader_t;
+
+// Entries follow the header, one per texture.
+typedef struct
+{
+  int32_t   width;
+  int32_t   compositesize;
+  // Column lumps, then column offsets, width of each.
+  uint32_t  lookupofs;
+  // 0 when no column has more than one patch.
+  uint32_t  compositeofs;
+} tcacheentry_t;
+
+
+//
+// R_TextureCacheName
+// Returns false when the cache should not be used.
+//
+static bool R_TextureCacheName (char* name, size_t size)
+{
+  const char* home = getenv ("HOME");
+
+  if (M_CheckParm ("-notexcache") || !home)
+  {
+    return false;
+  }
+
+  snprintf (name, size, "%s/.doomtexcache", home);
+  return true;
+}
+
+
+//
+// R_CheckTextureCacheColumns
+// True if every column of a cached texture lies within
+//  its patch lump, or within its composite.
+//
+static bool
+R_CheckTextureCacheColumns
+( uint8_t*  base,
+  tcacheentry_t*  entry,
+  int   texnum )
+{
+  short*    collump;
+  unsigned short* colofs;
+  int     x;
+
+  collump = (short*) (base + entry->lookupofs);
+  colofs = (unsigned short*) (collump + entry->width);
+
+  for (x = 0 ; x < entry->width ; x++)
+  {
+    if (collump[x] > 0)
+    {
+      if (collump[x] >= W_NumLumps ()
+          || colofs[x] >= W_LumpLength (collump[x]))
+      {
+        return false;
+      }
+    }
+    else if (!entry->compositeofs
+             || colofs[x] + textures[texnum]->height
+                > entry->compositesize)
+    {
+      // R_GetColumn reads these from the mapped composite.
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+//
+// R_LoadTextureCache
+// Maps the cache file and points the lookups into it.
+// Returns false if there is no valid cache for these WADs.
+//
+static bool R_LoadTextureCache (void)
+{
+  char    name[1024];
+  uint64_t  hash;
+  int     size;
+  uint8_t*   base;
+  tcacheheader_t* header;
+  tcacheentry_t*  entry;
+  uint64_t  end;
+  int     i;
+
+  hash = W_HashWadSet ();
+
+  if (!hash || !R_TextureCacheName (name, sizeof(name)))
+  {
+    return false;
+  }
+
+  if (!(base = I_MapFile (name, &size)))
+  {
+    return false;
+  }
+
+  header = (tcacheheader_t*) base;
+  entry = (tcacheentry_t*) (header + 1);
+
+  if (size < (int) sizeof(*header)
+      || header->magic != TCACHE_MAGIC
+      || header->version != TCACHE_VERSION
+      || header->hash != hash
+      || header->numtextures != numtextures
+      || header->size != size
+      || sizeof(*header) + numtextures * sizeof(*entry) > (size_t) header->size)
+  {
+    I_UnmapFile (base, size);
+    return false;
+  }
+
+  // Check every entry before using any of them,
+  //  in 64 bits so a corrupt offset can't wrap around.
+  for (i = 0 ; i < numtextures ; i++)
+  {
+    end = (uint64_t) entry[i].lookupofs
+          + (uint64_t) entry[i].width * 2 * sizeof(short);
+
+    if (entry[i].width != textures[i]->width
+        || entry[i].lookupofs & 1
+        || entry[i].compositesize < 0
+        || end > (uint64_t) header->size
+        || (uint64_t) entry[i].compositeofs + entry[i].compositesize
+           > (uint64_t) header->size
+        || !R_CheckTextureCacheColumns (base, &entry[i], i))
+    {
+      I_UnmapFile (base, size);
+      return false;
+    }
+  }
+
+  for (i = 0 ; i < numtextures ; i++)
+  {
+    texturecolumnlump[i] = (short*) (base + entry[i].lookupofs);
+    texturecolumnofs[i] =
+      (unsigned short*) (texturecolumnlump[i] + entry[i].width);
+    texturecompositesize[i] = entry[i].compositesize;
+
+    if (entry[i].compositeofs)
+    {
+      texturecomposite[i] = base + entry[i].compositeofs;
+    }
+    else
+    {
+      texturecomposite[i] = NULL;
+    }
+  }
+
+  compositesmapped = true;
+
+  printf ("\nR_LoadTextureCache: %s", name);
+  return true;
+}
+
+
+//
+// R_WriteTextureCache
+// Appends size bytes to the cache file being written.
+//
+static bool R_WriteTextureCache (FILE* handle, const void* data, int size)
+{
+  return fwrite (data, 1, size, handle) == (size_t) size;
+}
+
+
+//
+// R_SaveTextureCache
+// Writes the lookups just generated, and every composite,
+//  for the next run. The file is written under a temporary
+//  name and renamed, so a partial file is never mapped.
+//
+static void R_SaveTextureCache (void)
+{
+  char    name[1024];
+  char    tempname[1040];
+  tcacheheader_t  header;
+  tcacheentry_t*  entry;
+  uint32_t  offset;
+  FILE*   handle;
+  bool    ok;
+  int     i;
+
+  header.hash = W_HashWadSet ();
+
+  if (!header.hash || !R_TextureCacheName (name, sizeof(name)))
+  {
+    return;
+  }
+
+  entry = malloc (numtextures * sizeof(*entry));
+
+  if (!entry)
+  {
+    return;
+  }
+
+  // Lay out the file: header, entries, lookups, composites.
+  offset = sizeof(header) + numtextures * sizeof(*entry);
+
+  for (i = 0 ; i < numtextures ; i++)
+  {
+    entry[i].width = textures[i]->width;
+    entry[i].compositesize = texturecompositesize[i];
+    entry[i].lookupofs = offset;
+    offset += textures[i]->width * 2 * sizeof(short);
+  }
+
+  for (i = 0 ; i < numtextures ; i++)
+  {
+    entry[i].compositeofs = texturecompositesize[i] ? offset : 0;
+    offset += texturecompositesize[i];
+  }
+
+  header.magic = TCACHE_MAGIC;
+  header.version = TCACHE_VERSION;
+  header.numtextures = numtextures;
+  header.size = offset;
+
+  snprintf (tempname, sizeof(tempname), "%s.tmp", name);
+
+  if (!(handle = fopen (tempname, "wb")))
+  {
+    free (entry);
+    return;
+  }
+
+  ok = R_WriteTextureCache (handle, &header, sizeof(header))
+       && R_WriteTextureCache (handle, entry, numtextures * sizeof(*entry));
+
+  for (i = 0 ; ok && i < numtextures ; i++)
+  {
+    ok = R_WriteTextureCache (handle, texturecolumnlump[i],
+                              textures[i]->width * sizeof(short))
+         && R_WriteTextureCache (handle, texturecolumnofs[i],
+                                 textures[i]->width * sizeof(short));
+  }
+
+  // Composites are built here once, instead of a column
+  //  at a time as they are drawn. Each is written before
+  //  the next one can push it out of the composite cache.
+  for (i = 0 ; ok && i < numtextures ; i++)
+  {
+    if (!texturecompositesize[i])
+    {
+      continue;
+    }
+
+    R_GenerateComposite (i);
+
+    ok = R_WriteTextureCache (handle, texturecomposite[i],
+                              texturecompositesize[i]);
+  }
+
+  free (entry);
+
+  if (fclose (handle) || !ok || rename (tempname, name))
+  {
+    printf ("\nR_SaveTextureCache: couldn't write %s", name);
+    remove (tempname);
+  }
+}
+
+
+
 //
 // R_InitTextures
 // Initializes the texture list
@@ -504,9 +936,18 @@ void R_InitTextures (void)
   texturecolumnofs = Z_Malloc(numtextures * sizeof(*texturecolumnofs), PU_STATIC, NULL);
   texturecomposite = Z_Malloc(numtextures * sizeof(*texturecomposite), PU_STATIC, NULL);
   texturecompositesize = Z_Malloc(numtextures * sizeof(*texturecompositesize), PU_STATIC, NULL);
+  compositenext = Z_Malloc(numtextures * sizeof(*compositenext), PU_STATIC, NULL);
+  compositeprev = Z_Malloc(numtextures * sizeof(*compositeprev), PU_STATIC, NULL);
+  compositeframe = Z_Malloc(numtextures * sizeof(*compositeframe), PU_STATIC, NULL);
   texturewidthmask = Z_Malloc(numtextures * sizeof(*texturewidthmask), PU_STATIC, NULL);
   textureheight = Z_Malloc(numtextures * sizeof(*textureheight), PU_STATIC, NULL);
 
+  i = M_CheckParm ("-compositecache");
+  if (i && i < myargc - 1)
+  {
+    compositebudget = atoi (myargv[i + 1]) * 1024;
+  }
+
   totalwidth = 0;
 
   //  Really complex printing shit...
@@ -573,8 +1014,6 @@ void R_InitTextures (void)
                  texture->name);
       }
     }
-    texturecolumnlump[i] = Z_Malloc(texture->width * sizeof(short), PU_STATIC, NULL);
-    texturecolumnofs[i] = Z_Malloc(texture->width * sizeof(unsigned short), PU_STATIC, NULL);
 
     j = 1;
     while (j * 2 <= texture->width)
@@ -594,10 +1033,16 @@ void R_InitTextures (void)
     Z_Free (maptex2);
   }
 
-  // Precalculate whatever possible.
-  for (i = 0 ; i < numtextures ; i++)
+  // Precalculate whatever possible,
+  //  unless an earlier run left it on disk.
+  if (!R_LoadTextureCache ())
   {
-    R_GenerateLookup (i);
+    for (i = 0 ; i < numtextures ; i++)
+    {
+      R_GenerateLookup (i);
+    }
+
+    R_SaveTextureCache ();
   }
 
   // Create translation table for global animation.
@@ -629,6 +1074,63 @@ void R_InitFlats (void)
   {
     flattranslation[i] = i;
   }
+
+  linearflats = M_CheckParm ("-linearflats") != 0;
+  tiledflats = Z_Malloc (numflats * sizeof(*tiledflats), PU_STATIC, 0);
+  memset (tiledflats, 0, numflats * sizeof(*tiledflats));
+}
+
+
+//
+// R_TileFlat
+// Reorders a flat into 8x8 texel tiles, row by row within a tile,
+//  so each tile fills one 64 byte cache line.
+// A span stepping diagonally stays in one line for several texels,
+//  where stored row by row it touches a new line nearly every texel.
+// The span kernels address it as
+//  v5v4v3 u5u4u3 v2v1v0 u2u1u0.
+//
+static void R_TileFlat (uint8_t* dest, const uint8_t* source)
+{
+  int     u;
+  int     v;
+
+  for (v = 0 ; v < 64 ; v++)
+  {
+    for (u = 0 ; u < 64 ; u++)
+    {
+      dest[((v & 56) << 6) | ((u & 56) << 3) | ((v & 7) << 3) | (u & 7)]
+        = source[v * 64 + u];
+    }
+  }
+}
+
+
+//
+// R_GetFlat
+// Returns a flat in the layout the span kernels sample,
+//  tagged PU_STATIC until the caller changes it to PU_CACHE.
+//
+uint8_t* R_GetFlat (int flat)
+{
+  const uint8_t*  source;
+
+  if (linearflats)
+  {
+    return W_CacheLumpNum (firstflat + flat, PU_STATIC);
+  }
+
+  if (tiledflats[flat])
+  {
+    Z_ChangeTag (tiledflats[flat], PU_STATIC);
+    return tiledflats[flat];
+  }
+
+  // Allocate first, caching the lump can't purge a PU_STATIC block.
+  Z_Malloc (64 * 64, PU_STATIC, &tiledflats[flat]);
+  source = W_CacheLumpNum (firstflat + flat, PU_CACHE);
+  R_TileFlat (tiledflats[flat], source);
+  return tiledflats[flat];
 }
 
 
@@ -788,7 +1290,7 @@ void R_PrecacheLevel (void)
     {
       lump = firstflat + i;
       flatmemory += lumpinfo[lump].size;
-      W_CacheLumpNum(lump, PU_CACHE);
+      Z_ChangeTag (R_GetFlat (i), PU_CACHE);
     }
   }
 
@@ -833,8 +1335,9 @@ void R_PrecacheLevel (void)
   spritepresent = (char*) Z_Malloc(numsprites, PU_STATIC, NULL);
   memset (spritepresent, 0, numsprites);
 
-  for (th = thinkercap.next ; th != &thinkercap ; th = th->next)
+  for (i = 0 ; i < numthinkers ; i++)
   {
+    th = thinkers[i];
     if (th->function.acp1 == (actionf_p1)P_MobjThinker)
     {
       spritepresent[((mobj_t*)th)->sprite] = 1;
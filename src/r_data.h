@@ -42,6 +42,10 @@ void R_PrecacheLevel (void);
 // lookup by name. For animation?
 int R_FlatNumForName(const char* name);
 
+// Flat data for the span drawers, see R_GetFlat.
+extern bool linearflats;
+uint8_t* R_GetFlat (int flat);
+
 
 // Called by P_Ticker for switches and animations,
 // returns the texture number for the texture name.
@@ -42,8 +42,6 @@
 #define SIL_TOP     2
 #define SIL_BOTH    3
 
-#define MAXDRAWSEGS   256
-
 
 
 
@@ -119,6 +117,10 @@ typedef struct
 
   int32_t         linecount;
   struct line_s** lines;  // [linecount] size
+
+  // heights at the start of the tic, for uncapped rendering
+  fixed_t         oldfloorheight;
+  fixed_t         oldceilingheight;
 } sector_t;
 
 //
@@ -409,25 +411,23 @@ typedef struct
 //
 // Now what is a visplane, anyway?
 //
-typedef struct
+typedef struct visplane_s
 {
+  // Next plane in the same R_FindPlane hash chain.
+  struct visplane_s*  next;
+
   fixed_t   height;
   int32_t   picnum;
   int32_t   lightlevel;
   int32_t   minx;
   int32_t   maxx;
 
-  // leave pads for [minx-1]/[maxx+1]
-
-  uint8_t      pad1;
-  // Here lies the rub for all
-  //  dynamic resize/change of resolution.
-  uint8_t      top[SCREENWIDTH];
-  uint8_t      pad2;
-  uint8_t      pad3;
-  // See above.
-  uint8_t      bottom[SCREENWIDTH];
-  uint8_t      pad4;
+  // One row per screen column, top is 0xffff
+  //  where the plane is not seen.
+  // Allocated with the plane, with pads
+  //  left for [minx-1]/[maxx+1].
+  unsigned short*  top;
+  unsigned short*  bottom;
 
 } visplane_t;
 
@@ -22,6 +22,8 @@
 //   e.g. inline assembly, different algorithms.
 //
 //-----------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <string.h>
@@ -29,11 +31,13 @@
 #include "doomdef.h"
 
 #include "i_system.h"
+#include "m_argv.h"
 #include "z_zone.h"
 #include "w_wad.h"
 
 #include "m_fixed.h"
 #include "r_main.h"
+#include "r_draw.h"
 
 // Needs access to LFB (guess what).
 #include "v_video.h"
@@ -42,12 +46,8 @@
 #include "doomstat.h"
 
 
-// ?
-#define MAXWIDTH      1120
-#define MAXHEIGHT     832
-
 // status bar height at bottom of screen
-#define SBARHEIGHT    32
+#define SBARHEIGHT    (SCREENHEIGHT - V_ScaleY (ORIGHEIGHT - 32))
 
 //
 // All drawing to the view buffer is accomplished in this file.
@@ -65,8 +65,18 @@ int   scaledviewwidth;
 int   viewheight;
 int   viewwindowx;
 int   viewwindowy;
-uint8_t*   ylookup[MAXHEIGHT];
-int   columnofs[MAXWIDTH];
+uint8_t**  ylookup;
+int*    columnofs;
+
+// With -colmajor the view is drawn into a column-major
+//  buffer, so column drawers write sequential bytes,
+//  and R_TransposeView copies it into screens[0].
+// columnstep is the distance to the next pixel down
+//  a column, rowstep the one to the next along a row.
+bool    columnmajor;
+int   columnstep;
+int   rowstep;
+static uint8_t*  viewbuffer;
 
 // Color tables for different players,
 //  translate a limited part to another
@@ -80,20 +90,111 @@ uint8_t    translations[3][256];
 //
 // R_DrawColumn
 // Source is the top of the column to scale.
+// The drawer parameters are thread local,
+//  the column band workers (r_thread.c)
+//  load their own copy for each queued draw.
 //
-lighttable_t*   dc_colormap;
-int     dc_x;
-int     dc_yl;
-int     dc_yh;
-fixed_t     dc_iscale;
-fixed_t     dc_texturemid;
+_Thread_local lighttable_t*   dc_colormap;
+_Thread_local int     dc_x;
+_Thread_local int     dc_yl;
+_Thread_local int     dc_yh;
+_Thread_local fixed_t     dc_iscale;
+_Thread_local fixed_t     dc_texturemid;
 
 // first pixel in a column (possibly virtual)
-uint8_t*     dc_source;
+_Thread_local uint8_t*     dc_source;
 
 // just for profiling
 int     dccount;
 
+//
+// Column kernels.
+// Draw count + 1 pixels down from dest, pitch apart, stepping
+//  frac through dc_source; blocky ones also copy each pixel
+//  to dest[pair], the other half of a low detail pixel.
+// COLUMN_KERNEL makes one for each mix of the choices below,
+//  so none of the loops tests anything but the count:
+//  - WRAP: texel rows wrap at 128, the way walls tile;
+//    R_ColumnWraps picks the kernel without it whenever
+//    the column stays within the first 128 rows,
+//    which is every sprite post and most walls.
+//  - TRANSLATED: player colors, through dc_translation.
+//  - BLOCKY: low detail.
+//
+typedef void (*columnkernel_t) (uint8_t*  dest,
+                                int       pitch,
+                                int       pair,
+                                int       count,
+                                fixed_t   frac,
+                                fixed_t   fracstep);
+
+#define TEXEL_WRAP        source[(frac >> FRACBITS) & 127]
+#define TEXEL             source[frac >> FRACBITS]
+#define TEXEL_TRANSLATED  translation[source[frac >> FRACBITS]]
+
+#define COLUMN_KERNEL(name, texel, blocky)                    \
+static void                                                   \
+name                                                          \
+( uint8_t*  dest,                                             \
+  int       pitch,                                            \
+  int       pair,                                             \
+  int       count,                                            \
+  fixed_t   frac,                                             \
+  fixed_t   fracstep )                                        \
+{                                                             \
+  const uint8_t*  source = dc_source;                         \
+  const uint8_t*  translation = dc_translation;               \
+  const lighttable_t* colormap = dc_colormap;                 \
+  uint8_t   pixel;                                            \
+                                                              \
+  (void) translation;                                         \
+  (void) pair;                                                \
+                                                              \
+  do                                                          \
+  {                                                           \
+    pixel = colormap[texel];                                  \
+    *dest = pixel;                                            \
+    if (blocky)                                               \
+    {                                                         \
+      dest[pair] = pixel;                                     \
+    }                                                         \
+    dest += pitch;                                            \
+    frac += fracstep;                                         \
+  }                                                           \
+  while (count--);                                            \
+}
+
+COLUMN_KERNEL (R_Column, TEXEL, false)
+COLUMN_KERNEL (R_ColumnWrap, TEXEL_WRAP, false)
+COLUMN_KERNEL (R_ColumnLow, TEXEL, true)
+COLUMN_KERNEL (R_ColumnWrapLow, TEXEL_WRAP, true)
+COLUMN_KERNEL (R_ColumnTranslated, TEXEL_TRANSLATED, false)
+
+// Indexed [blocky][wrap].
+static const columnkernel_t columnkernels[2][2] =
+{
+  { R_Column, R_ColumnWrap },
+  { R_ColumnLow, R_ColumnWrapLow }
+};
+
+//
+// R_ColumnWraps
+// True if a column starting at frac goes outside of rows 0-127.
+// Frac moves one way, so checking both ends is enough.
+//
+static inline int
+R_ColumnWraps
+( fixed_t   frac,
+  fixed_t   fracstep,
+  int       count )
+{
+  int64_t   last = (int64_t)frac + (int64_t)fracstep * count;
+
+  return frac < 0 || frac >= 128 << FRACBITS
+         || last < 0 || last >= 128 << FRACBITS;
+}
+
+
 //
 // A column is a vertical slice/span from a wall texture that,
 //  given the DOOM style restrictions on the view orientation,
@@ -117,7 +218,7 @@ void R_DrawColumn (void)
   }
 
 #ifdef RANGECHECK
-  if ((unsigned)dc_x >= SCREENWIDTH
+  if ((unsigned)dc_x >= (unsigned)SCREENWIDTH
       || dc_yl < 0
       || dc_yh >= SCREENHEIGHT)
   {
@@ -136,26 +237,187 @@ void R_DrawColumn (void)
   frac = dc_texturemid + (dc_yl - centery) * fracstep;
 
   // Inner loop that does the actual texture mapping,
-  //  e.g. a DDA-lile scaling.
-  // This is as fast as it gets.
+  //  e.g. a DDA-lile scaling, re-mapping color indices
+  //  from the wall texture column through a lighting LUT.
+  columnkernels[0][R_ColumnWraps (frac, fracstep, count)]
+    (dest, columnstep, 0, count, frac, fracstep);
+}
+
+
+//
+// R_DrawColumnQuad
+// Same as R_DrawColumn, but the column goes to a buffer
+//  holding four adjacent columns, interleaved by row.
+// R_FlushColumns writes the buffer out row by row,
+//  with a single 4 byte store wherever all four columns
+//  are present, instead of touching a new line of the
+//  framebuffer for every pixel of every column.
+// Only used for row-major views, a column-major one
+//  already gets sequential stores from R_DrawColumn,
+//  and only through wallcolfunc: the top and bottom of
+//  two sided walls and the posts of sprites come back to
+//  the same column too often to fill a group, and cost
+//  more buffered than drawn straight.
+// A column drawn twice in the same group, or one outside
+//  of the group, flushes the buffer first, so overlapping
+//  draws still land in order.
+//
+static _Thread_local uint8_t*  quadbuf;
+static _Thread_local int  quadx;
+static _Thread_local int  quadused;
+static _Thread_local int  quadyl[4];
+static _Thread_local int  quadyh[4];
+
+void R_DrawColumnQuad (void)
+{
+  int     count;
+  int     col;
+  uint8_t*   dest;
+  fixed_t   frac;
+  fixed_t   fracstep;
+
+  count = dc_yh - dc_yl;
+
+  // Zero length, column does not exceed a pixel.
+  if (count < 0)
+  {
+    return;
+  }
+
+#ifdef RANGECHECK
+  if ((unsigned)dc_x >= (unsigned)SCREENWIDTH
+      || dc_yl < 0
+      || dc_yh >= SCREENHEIGHT)
+  {
+    I_Error ("R_DrawColumnQuad: %i to %i at %i", dc_yl, dc_yh, dc_x);
+  }
+#endif
+
+  if (!quadbuf)
+  {
+    // One per thread, sized for the screen.
+    quadbuf = malloc (SCREENHEIGHT * 4);
+
+    if (!quadbuf)
+    {
+      I_Error ("R_DrawColumnQuad: no memory");
+    }
+  }
+
+  col = dc_x & 3;
+
+  if (quadused && ((dc_x & ~3) != quadx || (quadused & (1 << col))))
+  {
+    R_FlushColumns ();
+  }
+
+  quadx = dc_x & ~3;
+  quadused |= 1 << col;
+  quadyl[col] = dc_yl;
+  quadyh[col] = dc_yh;
+
+  dest = quadbuf + dc_yl * 4 + col;
+
+  fracstep = dc_iscale;
+  frac = dc_texturemid + (dc_yl - centery) * fracstep;
+
+  columnkernels[0][R_ColumnWraps (frac, fracstep, count)]
+    (dest, 4, 0, count, frac, fracstep);
+}
+
+static void R_FlushColumn (int col, int yl, int yh)
+{
+  uint8_t*   source;
+  uint8_t*   dest;
+
+  if (yl > yh)
+  {
+    return;
+  }
+
+  source = quadbuf + yl * 4 + col;
+  dest = ylookup[yl] + columnofs[quadx + col];
+
   do
   {
-    // Re-map color indices from wall texture column
-    //  using a lighting/special effects LUT.
-    *dest = dc_colormap[dc_source[(frac >> FRACBITS) & 127]];
+    *dest = *source;
+    source += 4;
+    dest += columnstep;
+  }
+  while (++yl <= yh);
+}
 
-    dest += SCREENWIDTH;
-    frac += fracstep;
+//
+// R_FlushColumns
+// Must be called before anything else draws
+//  into the view after R_DrawColumnQuad.
+//
+void R_FlushColumns (void)
+{
+  int     col;
+  int     top;
+  int     bottom;
 
+  if (!quadused)
+  {
+    return;
   }
-  while (count--);
+
+  top = SCREENHEIGHT;
+  bottom = -1;
+
+  if (quadused == 15)
+  {
+    // Rows covered by all four columns.
+    top = quadyl[0];
+    bottom = quadyh[0];
+
+    for (col = 1 ; col < 4 ; col++)
+    {
+      if (quadyl[col] > top)
+      {
+        top = quadyl[col];
+      }
+      if (quadyh[col] < bottom)
+      {
+        bottom = quadyh[col];
+      }
+    }
+  }
+
+  if (top > bottom)
+  {
+    for (col = 0 ; col < 4 ; col++)
+    {
+      if (quadused & (1 << col))
+      {
+        R_FlushColumn (col, quadyl[col], quadyh[col]);
+      }
+    }
+  }
+  else
+  {
+    for (col = 0 ; col < 4 ; col++)
+    {
+      R_FlushColumn (col, quadyl[col], top - 1);
+      R_FlushColumn (col, bottom + 1, quadyh[col]);
+    }
+
+    for ( ; top <= bottom ; top++)
+    {
+      memcpy (ylookup[top] + columnofs[quadx], quadbuf + top * 4, 4);
+    }
+  }
+
+  quadused = 0;
 }
 
+
 void R_DrawColumnLow (void)
 {
   int     count;
+  int     x;
   uint8_t*   dest;
-  uint8_t*   dest2;
   fixed_t   frac;
   fixed_t   fracstep;
 
@@ -168,7 +430,7 @@ void R_DrawColumnLow (void)
   }
 
 #ifdef RANGECHECK
-  if ((unsigned)dc_x >= SCREENWIDTH
+  if ((unsigned)dc_x >= (unsigned)SCREENWIDTH
       || dc_yl < 0
       || dc_yh >= SCREENHEIGHT)
   {
@@ -178,32 +440,25 @@ void R_DrawColumnLow (void)
   //  dccount++;
 #endif
   // Blocky mode, need to multiply by 2.
-  dc_x <<= 1;
+  // Kept local, callers reuse dc_x between posts.
+  x = dc_x << 1;
 
-  dest = ylookup[dc_yl] + columnofs[dc_x];
-  dest2 = ylookup[dc_yl] + columnofs[dc_x + 1];
+  dest = ylookup[dc_yl] + columnofs[x];
 
   fracstep = dc_iscale;
   frac = dc_texturemid + (dc_yl - centery) * fracstep;
 
-  do
-  {
-    // Hack. Does not work corretly.
-    *dest2 = *dest = dc_colormap[dc_source[(frac >> FRACBITS) & 127]];
-    dest += SCREENWIDTH;
-    dest2 += SCREENWIDTH;
-    frac += fracstep;
-
-  }
-  while (count--);
+  columnkernels[1][R_ColumnWraps (frac, fracstep, count)]
+    (dest, columnstep, columnofs[x + 1] - columnofs[x],
+     count, frac, fracstep);
 }
 
 
 //
 // Spectre/Invisibility.
 //
-#define FUZZTABLE   50
-#define FUZZOFF (SCREENWIDTH)
+// Offsets are in rows, the screen width is only known at runtime.
+#define FUZZOFF (1)
 
 
 int fuzzoffset[FUZZTABLE] =
@@ -217,7 +472,7 @@ int fuzzoffset[FUZZTABLE] =
   FUZZOFF, FUZZOFF, -FUZZOFF, FUZZOFF, FUZZOFF, -FUZZOFF, FUZZOFF
 };
 
-int fuzzpos = 0;
+_Thread_local int fuzzpos = 0;
 
 
 //
@@ -257,7 +512,7 @@ void R_DrawFuzzColumn (void)
 
 
 #ifdef RANGECHECK
-  if ((unsigned)dc_x >= SCREENWIDTH
+  if ((unsigned)dc_x >= (unsigned)SCREENWIDTH
       || dc_yl < 0 || dc_yh >= SCREENHEIGHT)
   {
     I_Error ("R_DrawFuzzColumn: %i to %i at %i",
@@ -307,7 +562,7 @@ void R_DrawFuzzColumn (void)
     //  a pixel that is either one column
     //  left or right of the current one.
     // Add index from colormap to index.
-    *dest = colormaps[6 * 256 + dest[fuzzoffset[fuzzpos]]];
+    *dest = colormaps[6 * 256 + dest[fuzzoffset[fuzzpos] * columnstep]];
 
     // Clamp table lookup index.
     if (++fuzzpos == FUZZTABLE)
@@ -315,7 +570,7 @@ void R_DrawFuzzColumn (void)
       fuzzpos = 0;
     }
 
-    dest += SCREENWIDTH;
+    dest += columnstep;
 
     frac += fracstep;
   }
@@ -334,7 +589,7 @@ void R_DrawFuzzColumn (void)
 //  of the BaronOfHell, the HellKnight, uses
 //  identical sprites, kinda brightened up.
 //
-uint8_t* dc_translation;
+_Thread_local uint8_t* dc_translation;
 uint8_t* translationtables;
 
 void R_DrawTranslatedColumn (void)
@@ -351,7 +606,7 @@ void R_DrawTranslatedColumn (void)
   }
 
 #ifdef RANGECHECK
-  if ((unsigned)dc_x >= SCREENWIDTH
+  if ((unsigned)dc_x >= (unsigned)SCREENWIDTH
       || dc_yl < 0
       || dc_yh >= SCREENHEIGHT)
   {
@@ -389,19 +644,12 @@ void R_DrawTranslatedColumn (void)
   frac = dc_texturemid + (dc_yl - centery) * fracstep;
 
   // Here we do an additional index re-mapping.
-  do
-  {
-    // Translation tables are used
-    //  to map certain colorramps to other ones,
-    //  used with PLAY sprites.
-    // Thus the "green" ramp of the player 0 sprite
-    //  is mapped to gray, red, black/indigo.
-    *dest = dc_colormap[dc_translation[dc_source[frac >> FRACBITS]]];
-    dest += SCREENWIDTH;
-
-    frac += fracstep;
-  }
-  while (count--);
+  // Translation tables are used
+  //  to map certain colorramps to other ones,
+  //  used with PLAY sprites.
+  // Thus the "green" ramp of the player 0 sprite
+  //  is mapped to gray, red, black/indigo.
+  R_ColumnTranslated (dest, columnstep, 0, count, frac, fracstep);
 }
 
 /**
@@ -446,39 +694,493 @@ void R_InitTranslationTables()
 // In consequence, flats are not stored by column (like walls),
 //  and the inner loop has to step in texture space u and v.
 //
-int     ds_y;
-int     ds_x1;
-int     ds_x2;
+_Thread_local int     ds_y;
+_Thread_local int     ds_x1;
+_Thread_local int     ds_x2;
 
-lighttable_t*   ds_colormap;
+_Thread_local lighttable_t*   ds_colormap;
 
-fixed_t     ds_xfrac;
-fixed_t     ds_yfrac;
-fixed_t     ds_xstep;
-fixed_t     ds_ystep;
+_Thread_local fixed_t     ds_xfrac;
+_Thread_local fixed_t     ds_yfrac;
+_Thread_local fixed_t     ds_xstep;
+_Thread_local fixed_t     ds_ystep;
 
 // start of a 64*64 tile image
-uint8_t*     ds_source;
+_Thread_local uint8_t*     ds_source;
 
 // just for profiling
 int     dscount;
 
 
+//
+// Texel offsets, see R_TileFlat.
+// A kernel addresses the flat as
+//  ((yfrac >> 10) & spanvhi) | ((yfrac >> 13) & spanvlo)
+//  | ((xfrac >> 13) & spanuhi) | ((xfrac >> 16) & spanulo),
+//  which R_InitSpanDrawer sets up for tiled flats,
+//  or for the row by row v * 64 + u of -linearflats.
+//
+static unsigned spanvhi = 63 * 64;
+static unsigned spanvlo = 0;
+static unsigned spanuhi = 0;
+static unsigned spanulo = 63;
+
+//
+// Span kernels.
+// Draw count texels of the current span, starting at
+//  xfrac/yfrac, one pixel each or two in blocky mode.
+// The SIMD kernels work out eight texture offsets at once
+//  and finish the tail with the plain loop, so every kernel
+//  gives the same pixels.
+// Each is written once with blocky as a parameter and made
+//  into a plain and a blocky kernel by SPAN_KERNELS, so the
+//  blocky tests fold away.
+//
+typedef void (*spankernel_t) (uint8_t*  dest,
+                              int       count,
+                              fixed_t   xfrac,
+                              fixed_t   yfrac);
+
+#define SPAN_INLINE static inline __attribute__((always_inline))
+
+#define SPAN_KERNELS(name, body, attributes)                      \
+attributes static void                                            \
+name                                                              \
+( uint8_t*  dest,                                                 \
+  int       count,                                                \
+  fixed_t   xfrac,                                                \
+  fixed_t   yfrac )                                               \
+{                                                                 \
+  body (dest, count, xfrac, yfrac, false);                        \
+}                                                                 \
+                                                                  \
+attributes static void                                            \
+name##Low                                                         \
+( uint8_t*  dest,                                                 \
+  int       count,                                                \
+  fixed_t   xfrac,                                                \
+  fixed_t   yfrac )                                               \
+{                                                                 \
+  body (dest, count, xfrac, yfrac, true);                         \
+}
+
+SPAN_INLINE void
+R_SpanPixels
+( uint8_t*  dest,
+  int       count,
+  fixed_t   xfrac,
+  fixed_t   yfrac,
+  bool      blocky )
+{
+  int     spot;
+  uint8_t    pixel;
+
+  while (count-- > 0)
+  {
+    // Current texture index in u,v.
+    spot = ((yfrac >> (16 - 6)) & spanvhi) | ((yfrac >> (16 - 3)) & spanvlo)
+           | ((xfrac >> (16 - 3)) & spanuhi) | ((xfrac >> 16) & spanulo);
+
+    // Lookup pixel from flat texture tile,
+    //  re-index using light/colormap.
+    pixel = ds_colormap[ds_source[spot]];
+    *dest++ = pixel;
+
+    // Lowres/blocky mode does it twice,
+    //  while scale is adjusted appropriately.
+    if (blocky)
+    {
+      *dest++ = pixel;
+    }
+
+    // Next step in u,v.
+    xfrac += ds_xstep;
+    yfrac += ds_ystep;
+  }
+}
+
+SPAN_KERNELS (R_SpanScalar, R_SpanPixels, )
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SPAN_X86
+#include <immintrin.h>
+
+// Stores eight texels from the low half of a vector.
+#define SPAN_STORE(dest, texels, blocky)                          \
+  do                                                              \
+  {                                                               \
+    if (blocky)                                                   \
+    {                                                             \
+      _mm_storeu_si128 ((__m128i*)(dest),                         \
+                        _mm_unpacklo_epi8 ((texels), (texels)));  \
+      (dest) += 16;                                               \
+    }                                                             \
+    else                                                          \
+    {                                                             \
+      _mm_storel_epi64 ((__m128i*)(dest), (texels));              \
+      (dest) += 8;                                                \
+    }                                                             \
+  } while (0)
+
+// Texel offsets for four x/y pairs.
+#define SPAN_SPOTS_SSE2(x, y)                                           \
+  _mm_or_si128 (                                                        \
+    _mm_or_si128 (_mm_and_si128 (_mm_srli_epi32 ((y), 16 - 6), vhi),    \
+                  _mm_and_si128 (_mm_srli_epi32 ((y), 16 - 3), vlo)),   \
+    _mm_or_si128 (_mm_and_si128 (_mm_srli_epi32 ((x), 16 - 3), uhi),    \
+                  _mm_and_si128 (_mm_srli_epi32 ((x), 16), ulo)))
+
+//
+// SSE2: the offsets are vectorized, the two lookups
+//  stay scalar since there is no gather.
+//
+__attribute__((target("sse2")))
+SPAN_INLINE void
+R_SpanSSE2Pixels
+( uint8_t*  dest,
+  int       count,
+  fixed_t   xfrac,
+  fixed_t   yfrac,
+  bool      blocky )
+{
+  const uint8_t* source = ds_source;
+  const lighttable_t* colormap = ds_colormap;
+  const unsigned  xstep = ds_xstep;
+  const unsigned  ystep = ds_ystep;
+  const __m128i xstep4 = _mm_set1_epi32 (xstep * 4);
+  const __m128i ystep4 = _mm_set1_epi32 (ystep * 4);
+  const __m128i vhi = _mm_set1_epi32 (spanvhi);
+  const __m128i vlo = _mm_set1_epi32 (spanvlo);
+  const __m128i uhi = _mm_set1_epi32 (spanuhi);
+  const __m128i ulo = _mm_set1_epi32 (spanulo);
+  __m128i   x;
+  __m128i   y;
+  __m128i   spotlo;
+  __m128i   spothi;
+  __m128i   spots;
+  __m128i   texels;
+
+  x = _mm_setr_epi32 (xfrac, xfrac + xstep,
+                      xfrac + xstep * 2, xfrac + xstep * 3);
+  y = _mm_setr_epi32 (yfrac, yfrac + ystep,
+                      yfrac + ystep * 2, yfrac + ystep * 3);
+
+  for ( ; count >= 8 ; count -= 8)
+  {
+    spotlo = SPAN_SPOTS_SSE2 (x, y);
+    x = _mm_add_epi32 (x, xstep4);
+    y = _mm_add_epi32 (y, ystep4);
+
+    spothi = SPAN_SPOTS_SSE2 (x, y);
+    x = _mm_add_epi32 (x, xstep4);
+    y = _mm_add_epi32 (y, ystep4);
+
+    // Offsets are below 4096, two to a dword.
+    spots = _mm_packs_epi32 (spotlo, spothi);
+
+    texels = _mm_setr_epi8 (
+               colormap[source[_mm_extract_epi16 (spots, 0)]],
+               colormap[source[_mm_extract_epi16 (spots, 1)]],
+               colormap[source[_mm_extract_epi16 (spots, 2)]],
+               colormap[source[_mm_extract_epi16 (spots, 3)]],
+               colormap[source[_mm_extract_epi16 (spots, 4)]],
+               colormap[source[_mm_extract_epi16 (spots, 5)]],
+               colormap[source[_mm_extract_epi16 (spots, 6)]],
+               colormap[source[_mm_extract_epi16 (spots, 7)]],
+               0, 0, 0, 0, 0, 0, 0, 0);
+
+    SPAN_STORE (dest, texels, blocky);
+  }
+
+  R_SpanPixels (dest, count,
+                _mm_cvtsi128_si32 (x), _mm_cvtsi128_si32 (y), blocky);
+}
+
+SPAN_KERNELS (R_SpanSSE2, R_SpanSSE2Pixels, __attribute__((target("sse2"))))
+
+//
+// AVX2: both lookups are gathers.
+// Gathers fetch dwords, so each byte is read from the aligned
+//  dword holding it and shifted down; with a dword aligned flat
+//  and colormap that never reads outside of them.
+//
+__attribute__((target("avx2")))
+SPAN_INLINE void
+R_SpanAVX2Pixels
+( uint8_t*  dest,
+  int       count,
+  fixed_t   xfrac,
+  fixed_t   yfrac,
+  bool      blocky )
+{
+  const int* source = (const int*) ds_source;
+  const int* colormap = (const int*) ds_colormap;
+  const unsigned  xstep = ds_xstep;
+  const unsigned  ystep = ds_ystep;
+  const __m256i lanes = _mm256_setr_epi32 (0, 1, 2, 3, 4, 5, 6, 7);
+  const __m256i xstep8 = _mm256_set1_epi32 (xstep * 8);
+  const __m256i ystep8 = _mm256_set1_epi32 (ystep * 8);
+  const __m256i vhi = _mm256_set1_epi32 (spanvhi);
+  const __m256i vlo = _mm256_set1_epi32 (spanvlo);
+  const __m256i uhi = _mm256_set1_epi32 (spanuhi);
+  const __m256i ulo = _mm256_set1_epi32 (spanulo);
+  const __m256i dwordmask = _mm256_set1_epi32 (~3);
+  const __m256i bytemask = _mm256_set1_epi32 (3);
+  const __m256i lowbyte = _mm256_set1_epi32 (0xff);
+  const __m256i collect = _mm256_setr_epi8 (
+                            0, 4, 8, 12, -1, -1, -1, -1,
+                            -1, -1, -1, -1, -1, -1, -1, -1,
+                            0, 4, 8, 12, -1, -1, -1, -1,
+                            -1, -1, -1, -1, -1, -1, -1, -1);
+  __m256i   x;
+  __m256i   y;
+  __m256i   spots;
+  __m256i   texels;
+  __m128i   pixels;
+
+  x = _mm256_add_epi32 (_mm256_set1_epi32 (xfrac),
+                        _mm256_mullo_epi32 (lanes, _mm256_set1_epi32 (xstep)));
+  y = _mm256_add_epi32 (_mm256_set1_epi32 (yfrac),
+                        _mm256_mullo_epi32 (lanes, _mm256_set1_epi32 (ystep)));
+
+  for ( ; count >= 8 ; count -= 8)
+  {
+    spots = _mm256_or_si256 (
+              _mm256_or_si256 (
+                _mm256_and_si256 (_mm256_srli_epi32 (y, 16 - 6), vhi),
+                _mm256_and_si256 (_mm256_srli_epi32 (y, 16 - 3), vlo)),
+              _mm256_or_si256 (
+                _mm256_and_si256 (_mm256_srli_epi32 (x, 16 - 3), uhi),
+                _mm256_and_si256 (_mm256_srli_epi32 (x, 16), ulo)));
+    x = _mm256_add_epi32 (x, xstep8);
+    y = _mm256_add_epi32 (y, ystep8);
+
+    texels = _mm256_i32gather_epi32 (
+               source, _mm256_and_si256 (spots, dwordmask), 1);
+    texels = _mm256_and_si256 (
+               _mm256_srlv_epi32 (texels, _mm256_slli_epi32 (
+                                    _mm256_and_si256 (spots, bytemask), 3)),
+               lowbyte);
+
+    spots = texels;
+    texels = _mm256_i32gather_epi32 (
+               colormap, _mm256_and_si256 (spots, dwordmask), 1);
+    texels = _mm256_and_si256 (
+               _mm256_srlv_epi32 (texels, _mm256_slli_epi32 (
+                                    _mm256_and_si256 (spots, bytemask), 3)),
+               lowbyte);
+
+    // One byte per dword, four per 128 bit lane.
+    texels = _mm256_shuffle_epi8 (texels, collect);
+    pixels = _mm_unpacklo_epi32 (_mm256_castsi256_si128 (texels),
+                                 _mm256_extracti128_si256 (texels, 1));
+
+    SPAN_STORE (dest, pixels, blocky);
+  }
+
+  R_SpanPixels (dest, count,
+                _mm256_extract_epi32 (x, 0), _mm256_extract_epi32 (y, 0),
+                blocky);
+}
+
+SPAN_KERNELS (R_SpanAVX2, R_SpanAVX2Pixels, __attribute__((target("avx2"))))
+#endif
+
+//
+// Transpose kernels.
+// Copy a 16x16 block, turning its columns into rows.
+//
+typedef void (*transposekernel_t) (uint8_t*        dest,
+                                   int             destpitch,
+                                   const uint8_t*  source,
+                                   int             sourcepitch);
+
+static void
+R_TransposeScalar
+( uint8_t*        dest,
+  int             destpitch,
+  const uint8_t*  source,
+  int             sourcepitch )
+{
+  int     x;
+  int     y;
+
+  for (y = 0 ; y < 16 ; y++, dest += destpitch)
+  {
+    for (x = 0 ; x < 16 ; x++)
+    {
+      dest[x] = source[x * sourcepitch + y];
+    }
+  }
+}
+
+#ifdef SPAN_X86
+//
+// SSE2: interleaving source lines i and i+8 byte by byte
+//  is a perfect shuffle, four of them transpose the block.
+//
+__attribute__((target("sse2")))
+static void
+R_TransposeSSE2
+( uint8_t*        dest,
+  int             destpitch,
+  const uint8_t*  source,
+  int             sourcepitch )
+{
+  __m128i   a[16];
+  __m128i   b[16];
+  int     i;
+  int     pass;
+
+  for (i = 0 ; i < 16 ; i++)
+  {
+    a[i] = _mm_loadu_si128 ((const __m128i*)(source + i * sourcepitch));
+  }
+
+  for (pass = 0 ; pass < 2 ; pass++)
+  {
+    for (i = 0 ; i < 8 ; i++)
+    {
+      b[i * 2] = _mm_unpacklo_epi8 (a[i], a[i + 8]);
+      b[i * 2 + 1] = _mm_unpackhi_epi8 (a[i], a[i + 8]);
+    }
+
+    for (i = 0 ; i < 8 ; i++)
+    {
+      a[i * 2] = _mm_unpacklo_epi8 (b[i], b[i + 8]);
+      a[i * 2 + 1] = _mm_unpackhi_epi8 (b[i], b[i + 8]);
+    }
+  }
+
+  for (i = 0 ; i < 16 ; i++)
+  {
+    _mm_storeu_si128 ((__m128i*)(dest + i * destpitch), a[i]);
+  }
+}
+#endif
+
+// Indexed by blocky.
+static spankernel_t spankernels[2] = { R_SpanScalar, R_SpanScalarLow };
+static spankernel_t alignedspankernels[2] = { R_SpanScalar, R_SpanScalarLow };
+static transposekernel_t transposekernel = R_TransposeScalar;
+
+
+//
+// R_InitSpanDrawer
+// Picks the span and transpose kernels for this CPU.
+// -nosimd forces the plain C loops.
+//
+void R_InitSpanDrawer (void)
+{
+  const char*   name = "C";
+
+  spankernels[0] = alignedspankernels[0] = R_SpanScalar;
+  spankernels[1] = alignedspankernels[1] = R_SpanScalarLow;
+  transposekernel = R_TransposeScalar;
+
+  if (linearflats)
+  {
+    spanvhi = 63 * 64;
+    spanvlo = 0;
+    spanuhi = 0;
+    spanulo = 63;
+  }
+  else
+  {
+    spanvhi = 7 << 9;
+    spanvlo = 7 << 3;
+    spanuhi = 7 << 6;
+    spanulo = 7;
+  }
+
+#ifdef SPAN_X86
+  if (!M_CheckParm ("-nosimd"))
+  {
+    __builtin_cpu_init ();
+
+    if (__builtin_cpu_supports ("sse2"))
+    {
+      spankernels[0] = alignedspankernels[0] = R_SpanSSE2;
+      spankernels[1] = alignedspankernels[1] = R_SpanSSE2Low;
+      transposekernel = R_TransposeSSE2;
+      name = "SSE2";
+    }
+
+    if (__builtin_cpu_supports ("avx2"))
+    {
+      alignedspankernels[0] = R_SpanAVX2;
+      alignedspankernels[1] = R_SpanAVX2Low;
+      name = "AVX2";
+    }
+  }
+#endif
+
+  printf ("\nR_InitSpanDrawer: %s", name);
+}
+
+static _Thread_local uint8_t*  spanbuf;
+
+static void R_DrawSpanKernel (uint8_t* dest, int count, bool blocky)
+{
+  uint8_t*   row;
+  int     i;
+
+  // A column-major view has no sequential rows,
+  //  draw into a buffer and scatter from there.
+  row = dest;
+
+  if (rowstep != 1)
+  {
+    if (!spanbuf)
+    {
+      // One per thread, sized for the screen.
+      spanbuf = malloc (SCREENWIDTH);
+
+      if (!spanbuf)
+      {
+        I_Error ("R_DrawSpanKernel: no memory");
+      }
+    }
+
+    row = spanbuf;
+  }
+
+  if (((uintptr_t)ds_source | (uintptr_t)ds_colormap) & 3)
+  {
+    spankernels[blocky] (row, count, ds_xfrac, ds_yfrac);
+  }
+  else
+  {
+    alignedspankernels[blocky] (row, count, ds_xfrac, ds_yfrac);
+  }
+
+  if (row != dest)
+  {
+    if (blocky)
+    {
+      count *= 2;
+    }
+
+    for (i = 0 ; i < count ; i++, dest += rowstep)
+    {
+      *dest = row[i];
+    }
+  }
+}
+
+
 //
 // Draws the actual span.
 void R_DrawSpan (void)
 {
-  fixed_t   xfrac;
-  fixed_t   yfrac;
   uint8_t*   dest;
   int     count;
-  int     spot;
 
 #ifdef RANGECHECK
   if (ds_x2 < ds_x1
       || ds_x1 < 0
       || ds_x2 >= SCREENWIDTH
-      || (unsigned)ds_y > SCREENHEIGHT)
+      || (unsigned)ds_y > (unsigned)SCREENHEIGHT)
   {
     I_Error( "R_DrawSpan: %i to %i at %i",
              ds_x1, ds_x2, ds_y);
@@ -486,30 +1188,12 @@ void R_DrawSpan (void)
 //  dscount++;
 #endif
 
-
-  xfrac = ds_xfrac;
-  yfrac = ds_yfrac;
-
   dest = ylookup[ds_y] + columnofs[ds_x1];
 
   // We do not check for zero spans here?
   count = ds_x2 - ds_x1;
 
-  do
-  {
-    // Current texture index in u,v.
-    spot = ((yfrac >> (16 - 6)) & (63 * 64)) + ((xfrac >> 16) & 63);
-
-    // Lookup pixel from flat texture tile,
-    //  re-index using light/colormap.
-    *dest++ = ds_colormap[ds_source[spot]];
-
-    // Next step in u,v.
-    xfrac += ds_xstep;
-    yfrac += ds_ystep;
-
-  }
-  while (count--);
+  R_DrawSpanKernel (dest, count + 1, false);
 }
 
 //
@@ -517,17 +1201,14 @@ void R_DrawSpan (void)
 //
 void R_DrawSpanLow (void)
 {
-  fixed_t   xfrac;
-  fixed_t   yfrac;
   uint8_t*   dest;
   int     count;
-  int     spot;
 
 #ifdef RANGECHECK
   if (ds_x2 < ds_x1
       || ds_x1 < 0
       || ds_x2 >= SCREENWIDTH
-      || (unsigned)ds_y > SCREENHEIGHT)
+      || (unsigned)ds_y > (unsigned)SCREENHEIGHT)
   {
     I_Error( "R_DrawSpan: %i to %i at %i",
              ds_x1, ds_x2, ds_y);
@@ -535,8 +1216,9 @@ void R_DrawSpanLow (void)
 //  dscount++;
 #endif
 
-  xfrac = ds_xfrac;
-  yfrac = ds_yfrac;
+  // One texel per low detail pixel, counted before
+  //  doubling so the span stops at its right edge.
+  count = ds_x2 - ds_x1;
 
   // Blocky mode, need to multiply by 2.
   ds_x1 <<= 1;
@@ -544,21 +1226,7 @@ void R_DrawSpanLow (void)
 
   dest = ylookup[ds_y] + columnofs[ds_x1];
 
-
-  count = ds_x2 - ds_x1;
-  do
-  {
-    spot = ((yfrac >> (16 - 6)) & (63 * 64)) + ((xfrac >> 16) & 63);
-    // Lowres/blocky mode does it twice,
-    //  while scale is adjusted appropriately.
-    *dest++ = ds_colormap[ds_source[spot]];
-    *dest++ = ds_colormap[ds_source[spot]];
-
-    xfrac += ds_xstep;
-    yfrac += ds_ystep;
-
-  }
-  while (count--);
+  R_DrawSpanKernel (dest, count + 1, true);
 }
 
 //
@@ -575,6 +1243,17 @@ R_InitBuffer
 {
   int   i;
 
+  if (!ylookup)
+  {
+    ylookup = Z_Malloc (SCREENHEIGHT * sizeof(*ylookup), PU_STATIC, 0);
+    columnofs = Z_Malloc (SCREENWIDTH * sizeof(*columnofs), PU_STATIC, 0);
+
+    if (columnmajor)
+    {
+      viewbuffer = Z_Malloc (SCREENWIDTH * SCREENHEIGHT, PU_STATIC, 0);
+    }
+  }
+
   // Handle resize,
   //  e.g. smaller view windows
   //  with border and/or status bar.
@@ -601,6 +1280,85 @@ R_InitBuffer
   {
     ylookup[i] = screens[0] + (i + viewwindowy) * SCREENWIDTH;
   }
+
+  columnstep = SCREENWIDTH;
+  rowstep = 1;
+
+  // Column-major views start at the top of the buffer,
+  //  R_TransposeView puts them in place.
+  if (columnmajor)
+  {
+    for (i = 0 ; i < width ; i++)
+    {
+      columnofs[i] = i * SCREENHEIGHT;
+    }
+
+    for (i = 0 ; i < height ; i++)
+    {
+      ylookup[i] = viewbuffer + i;
+    }
+
+    columnstep = 1;
+    rowstep = SCREENHEIGHT;
+  }
+}
+
+
+
+//
+// R_TransposeView
+// Copies view columns x1 to x2 of a column-major view
+//  into screens[0], in 16x16 blocks so both sides stay
+//  in cache. The edges go a pixel at a time.
+//
+void
+R_TransposeView
+( int   x1,
+  int   x2 )
+{
+  uint8_t*   source;
+  uint8_t*   dest;
+  int     x;
+  int     y;
+  int     bx;
+  int     by;
+  int     w;
+  int     h;
+
+  for (x = x1 ; x <= x2 ; x += 16)
+  {
+    w = x2 + 1 - x;
+    if (w > 16)
+    {
+      w = 16;
+    }
+
+    for (y = 0 ; y < viewheight ; y += 16)
+    {
+      h = viewheight - y;
+      if (h > 16)
+      {
+        h = 16;
+      }
+
+      source = viewbuffer + x * SCREENHEIGHT + y;
+      dest = screens[0] + (viewwindowy + y) * SCREENWIDTH + viewwindowx + x;
+
+      if (w == 16 && h == 16)
+      {
+        transposekernel (dest, SCREENWIDTH, source, SCREENHEIGHT);
+        continue;
+      }
+
+      for (by = 0 ; by < h ; by++, dest += SCREENWIDTH)
+      {
+        for (bx = 0 ; bx < w ; bx++)
+        {
+          dest[bx] = source[bx * SCREENHEIGHT + by];
+        }
+      }
+    }
+  }
 }
 
 
@@ -616,8 +1374,13 @@ void R_FillBackScreen (void)
 {
   uint8_t* src;
   uint8_t* dest;
+  uint8_t* row;
   int   x;
   int   y;
+  int   viewx;
+  int   viewy;
+  int   vieww;
+  int   viewh;
   patch_t*  patch;
 
   // DOOM border patch.
@@ -628,7 +1391,7 @@ void R_FillBackScreen (void)
 
   char* name;
 
-  if (scaledviewwidth == 320)
+  if (scaledviewwidth == SCREENWIDTH)
   {
     return;
   }
@@ -645,65 +1408,67 @@ void R_FillBackScreen (void)
   src = W_CacheLumpName (name, PU_CACHE);
   dest = screens[1];
 
+  // The flat is scaled like the rest of the border.
   for (y = 0 ; y < SCREENHEIGHT - SBARHEIGHT ; y++)
   {
-    for (x = 0 ; x < SCREENWIDTH / 64 ; x++)
-    {
-      memcpy (dest, src + ((y & 63) << 6), 64);
-      dest += 64;
-    }
+    row = src + (((y * ORIGHEIGHT / SCREENHEIGHT) & 63) << 6);
 
-    if (SCREENWIDTH & 63)
+    for (x = 0 ; x < SCREENWIDTH ; x++)
     {
-      memcpy (dest, src + ((y & 63) << 6), SCREENWIDTH & 63);
-      dest += (SCREENWIDTH & 63);
+      *dest++ = row[(x * ORIGWIDTH / SCREENWIDTH) & 63];
     }
   }
 
+  // The border patches go in 320x200 coordinates.
+  viewx = viewwindowx * ORIGWIDTH / SCREENWIDTH;
+  viewy = viewwindowy * ORIGHEIGHT / SCREENHEIGHT;
+  vieww = scaledviewwidth * ORIGWIDTH / SCREENWIDTH;
+  viewh = viewheight * ORIGHEIGHT / SCREENHEIGHT;
+
   patch = W_CacheLumpName ("brdr_t", PU_CACHE);
 
-  for (x = 0 ; x < scaledviewwidth ; x += 8)
+  for (x = 0 ; x < vieww ; x += 8)
   {
-    V_DrawPatch (viewwindowx + x, viewwindowy - 8, 1, patch);
+    V_DrawPatch (viewx + x, viewy - 8, 1, patch);
   }
   patch = W_CacheLumpName ("brdr_b", PU_CACHE);
 
-  for (x = 0 ; x < scaledviewwidth ; x += 8)
+  for (x = 0 ; x < vieww ; x += 8)
   {
-    V_DrawPatch (viewwindowx + x, viewwindowy + viewheight, 1, patch);
+    V_DrawPatch (viewx + x, viewy + viewh, 1, patch);
   }
   patch = W_CacheLumpName ("brdr_l", PU_CACHE);
 
-  for (y = 0 ; y < viewheight ; y += 8)
+  for (y = 0 ; y < viewh ; y += 8)
   {
-    V_DrawPatch (viewwindowx - 8, viewwindowy + y, 1, patch);
+    V_DrawPatch (viewx - 8, viewy + y, 1, patch);
   }
   patch = W_CacheLumpName ("brdr_r", PU_CACHE);
 
-  for (y = 0 ; y < viewheight ; y += 8)
+  for (y = 0 ; y < viewh ; y += 8)
   {
-    V_DrawPatch (viewwindowx + scaledviewwidth, viewwindowy + y, 1, patch);
+    V_DrawPatch (viewx + vieww, viewy + y, 1, patch);
   }
 
 
   // Draw beveled edge.
-  V_DrawPatch (viewwindowx - 8,
-               viewwindowy - 8,
+  V_DrawPatch (viewx - 8,
+               viewy - 8,
                1,
                W_CacheLumpName ("brdr_tl", PU_CACHE));
 
-  V_DrawPatch (viewwindowx + scaledviewwidth,
-               viewwindowy - 8,
+  V_DrawPatch (viewx + vieww,
+               viewy - 8,
                1,
                W_CacheLumpName ("brdr_tr", PU_CACHE));
 
-  V_DrawPatch (viewwindowx - 8,
-               viewwindowy + viewheight,
+  V_DrawPatch (viewx - 8,
+               viewy + viewh,
                1,
                W_CacheLumpName ("brdr_bl", PU_CACHE));
 
-  V_DrawPatch (viewwindowx + scaledviewwidth,
-               viewwindowy + viewheight,
+  V_DrawPatch (viewx + vieww,
+               viewy + viewh,
                1,
                W_CacheLumpName ("brdr_br", PU_CACHE));
 }
@@ -717,12 +1482,31 @@ R_VideoErase
 ( unsigned  ofs,
   int   count )
 {
+  int   x;
+  int   y;
+
   // LFB copy.
   // This might not be a good idea if memcpy
   //  is not optiomal, e.g. byte by byte on
   //  a 32bit CPU, as GNU GCC/Linux libc did
   //  at one point.
   memcpy (screens[0] + ofs, screens[1] + ofs, count);
+
+  if (count <= 0)
+  {
+    return;
+  }
+
+  y = ofs / SCREENWIDTH;
+  x = ofs % SCREENWIDTH;
+  if (x + count <= SCREENWIDTH)
+  {
+    V_MarkRect (x, y, count, 1);
+  }
+  else
+  {
+    V_MarkRect (0, y, SCREENWIDTH, (ofs + count - 1) / SCREENWIDTH - y + 1);
+  }
 }
 
 
@@ -21,15 +21,19 @@
 #ifndef __R_DRAW__
 #define __R_DRAW__
 
-extern lighttable_t*  dc_colormap;
-extern int    dc_x;
-extern int    dc_yl;
-extern int    dc_yh;
-extern fixed_t    dc_iscale;
-extern fixed_t    dc_texturemid;
+// Drawer parameters, one set per thread.
+extern _Thread_local lighttable_t*  dc_colormap;
+extern _Thread_local int    dc_x;
+extern _Thread_local int    dc_yl;
+extern _Thread_local int    dc_yh;
+extern _Thread_local fixed_t    dc_iscale;
+extern _Thread_local fixed_t    dc_texturemid;
 
 // first pixel in a column
-extern uint8_t*    dc_source;
+extern _Thread_local uint8_t*    dc_source;
+
+// position in the Spectre fuzz table
+extern _Thread_local int    fuzzpos;
 
 
 // The span blitting interface.
@@ -38,7 +42,14 @@ extern uint8_t*    dc_source;
 void  R_DrawColumn (void);
 void  R_DrawColumnLow (void);
 
+// Batched R_DrawColumn, four columns at a time.
+// Users flush the batch before other drawing.
+void  R_DrawColumnQuad (void);
+void  R_FlushColumns (void);
+
 // The Spectre/Invisibility effect.
+#define FUZZTABLE   50
+
 void  R_DrawFuzzColumn (void);
 void  R_DrawFuzzColumnLow (void);
 
@@ -53,22 +64,22 @@ R_VideoErase
 ( unsigned  ofs,
   int   count );
 
-extern int    ds_y;
-extern int    ds_x1;
-extern int    ds_x2;
+extern _Thread_local int    ds_y;
+extern _Thread_local int    ds_x1;
+extern _Thread_local int    ds_x2;
 
-extern lighttable_t*  ds_colormap;
+extern _Thread_local lighttable_t*  ds_colormap;
 
-extern fixed_t    ds_xfrac;
-extern fixed_t    ds_yfrac;
-extern fixed_t    ds_xstep;
-extern fixed_t    ds_ystep;
+extern _Thread_local fixed_t    ds_xfrac;
+extern _Thread_local fixed_t    ds_yfrac;
+extern _Thread_local fixed_t    ds_xstep;
+extern _Thread_local fixed_t    ds_ystep;
 
 // start of a 64*64 tile image
-extern uint8_t*    ds_source;
+extern _Thread_local uint8_t*    ds_source;
 
 extern uint8_t*    translationtables;
-extern uint8_t*    dc_translation;
+extern _Thread_local uint8_t*    dc_translation;
 
 
 // Span blitting for rows, floor/ceiling.
@@ -78,12 +89,25 @@ void  R_DrawSpan (void);
 // Low resolution mode, 160x200?
 void  R_DrawSpanLow (void);
 
+// Selects SIMD span kernels if the CPU has them.
+void  R_InitSpanDrawer (void);
+
 
 void
 R_InitBuffer
 ( int   width,
   int   height );
 
+// Set by -colmajor, see R_InitBuffer.
+extern bool   columnmajor;
+
+// Copies view columns x1 to x2 of a column-major
+//  view into screens[0].
+void
+R_TransposeView
+( int   x1,
+  int   x2 );
+
 
 // Initialize color translation tables,
 //  for player rendering etc.
@@ -26,19 +26,27 @@
 #include <stdio.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 #include <math.h>
 
 #include "doomdef.h"
 #include "d_net.h"
 
 #include "m_bbox.h"
+#include "z_zone.h"
+#include "m_argv.h"
+#include "m_profile.h"
+#include "i_system.h"
+#include "v_video.h"
 
 #include "r_sky.h"
 #include "r_defs.h"
 #include "r_main.h"
 #include "r_bsp.h"
 #include "r_things.h"
+#include "r_thread.h"
 #include "r_plane.h"
+#include "r_pvs.h"
 #include "r_draw.h"
 
 // Fineangles in the SCREENWIDTH wide window.
@@ -75,6 +83,10 @@ fixed_t     viewz;
 
 angle_t     viewangle;
 
+// Position of this frame between the previous and the current tic,
+//  FRACUNIT draws the current tic as is.
+fixed_t     interpfrac = FRACUNIT;
+
 fixed_t     viewcos;
 fixed_t     viewsin;
 
@@ -97,12 +109,15 @@ int     viewangletox[FINEANGLES / 2];
 // The xtoviewangleangle[] table maps a screen pixel
 // to the lowest viewangle that maps back to x ranges
 // from clipangle to -clipangle.
-angle_t     xtoviewangle[SCREENWIDTH + 1];
+angle_t*    xtoviewangle;
 
 const fixed_t* finecosine = &finesine[FINEANGLES / 4];
 
 
 lighttable_t*   scalelight[LIGHTLEVELS][MAXLIGHTSCALE];
+
+// Brings scales back to a 320 wide screen for light lookups.
+fixed_t     lightscalefactor;
 lighttable_t*   scalelightfixed[MAXLIGHTSCALE];
 lighttable_t*   zlight[LIGHTLEVELS][MAXLIGHTZ];
 
@@ -113,6 +128,7 @@ int     extralight;
 
 void (*colfunc) (void);
 void (*basecolfunc) (void);
+void (*wallcolfunc) (void);
 void (*fuzzcolfunc) (void);
 void (*transcolfunc) (void);
 void (*spanfunc) (void);
@@ -424,6 +440,74 @@ R_PointToDist
   return dist;
 }
 
+//
+// Per frame vertex cache.
+// Segs share their vertices with the neighbouring segs,
+//  so each vertex is only run through the trig tables
+//  once a frame, the first time a seg asks for it.
+//
+typedef struct
+{
+  int       anglecount;   // framecount angle is good for
+  angle_t   angle;
+  int       distcount;
+  fixed_t   dist;
+} vertexcache_t;
+
+static vertexcache_t* vertexcache;
+static int            maxvertexcache;
+
+static void R_SetupVertexCache (void)
+{
+  if (maxvertexcache >= numvertexes)
+  {
+    return;
+  }
+
+  maxvertexcache = numvertexes;
+  vertexcache = realloc (vertexcache, maxvertexcache * sizeof(*vertexcache));
+  if (!vertexcache)
+  {
+    I_Error ("R_SetupVertexCache: out of memory");
+  }
+  memset (vertexcache, 0, maxvertexcache * sizeof(*vertexcache));
+}
+
+
+//
+// R_VertexAngle
+// R_PointToAngle of a map vertex.
+//
+angle_t R_VertexAngle (vertex_t* v)
+{
+  vertexcache_t*  cache = &vertexcache[v - vertexes];
+
+  if (cache->anglecount != framecount)
+  {
+    cache->anglecount = framecount;
+    cache->angle = R_PointToAngle (v->x, v->y);
+  }
+  return cache->angle;
+}
+
+
+//
+// R_VertexDist
+// R_PointToDist of a map vertex.
+//
+fixed_t R_VertexDist (vertex_t* v)
+{
+  vertexcache_t*  cache = &vertexcache[v - vertexes];
+
+  if (cache->distcount != framecount)
+  {
+    cache->distcount = framecount;
+    cache->dist = R_PointToDist (v->x, v->y);
+  }
+  return cache->dist;
+}
+
+
 //
 // R_ScaleFromGlobalAngle
 // Returns the texture mapping scale
@@ -573,7 +657,7 @@ void R_InitLightTables (void)
     startmap = ((LIGHTLEVELS - 1 - i) * 2) * NUMCOLORMAPS / LIGHTLEVELS;
     for (j = 0 ; j < MAXLIGHTZ ; j++)
     {
-      scale = FixedDiv ((SCREENWIDTH / 2 * FRACUNIT), (j + 1) << LIGHTZSHIFT);
+      scale = FixedDiv ((ORIGWIDTH / 2 * FRACUNIT), (j + 1) << LIGHTZSHIFT);
       scale >>= LIGHTSCALESHIFT;
       level = startmap - scale / DISTMAP;
 
@@ -637,8 +721,8 @@ void R_ExecuteSetViewSize (void)
   }
   else
   {
-    scaledviewwidth = setblocks * 32;
-    viewheight = (setblocks * 168 / 10) & ~7;
+    scaledviewwidth = V_ScaleX (setblocks * 32);
+    viewheight = V_ScaleY ((setblocks * 168 / 10) & ~7);
   }
 
   detailshift = setdetail;
@@ -653,25 +737,38 @@ void R_ExecuteSetViewSize (void)
   if (!detailshift)
   {
     colfunc = basecolfunc = R_DrawColumn;
+    wallcolfunc = columnmajor ? R_DrawColumn : R_DrawColumnQuad;
     fuzzcolfunc = R_DrawFuzzColumn;
     transcolfunc = R_DrawTranslatedColumn;
     spanfunc = R_DrawSpan;
   }
   else
   {
-    colfunc = basecolfunc = R_DrawColumnLow;
+    colfunc = basecolfunc = wallcolfunc = R_DrawColumnLow;
     fuzzcolfunc = R_DrawFuzzColumn;
     transcolfunc = R_DrawTranslatedColumn;
     spanfunc = R_DrawSpanLow;
   }
 
+  if (numrenderthreads > 1)
+  {
+    // Draws are queued and run in column bands.
+    colfunc = basecolfunc = R_QueueColumn;
+    wallcolfunc = R_QueueWallColumn;
+    fuzzcolfunc = R_QueueFuzzColumn;
+    transcolfunc = R_QueueTranslatedColumn;
+    spanfunc = R_QueueSpan;
+  }
+
   R_InitBuffer (scaledviewwidth, viewheight);
 
   R_InitTextureMapping ();
 
   // psprite scales
-  pspritescale = FRACUNIT * viewwidth / SCREENWIDTH;
-  pspriteiscale = FRACUNIT * SCREENWIDTH / viewwidth;
+  pspritescale = FRACUNIT * viewwidth / ORIGWIDTH;
+  pspriteiscale = FRACUNIT * ORIGWIDTH / viewwidth;
+
+  lightscalefactor = FRACUNIT * ORIGWIDTH / SCREENWIDTH;
 
   // thing clipping
   for (i = 0 ; i < viewwidth ; i++)
@@ -729,6 +826,9 @@ extern int  screenblocks;
 
 void R_Init (void)
 {
+  xtoviewangle = Z_Malloc ((SCREENWIDTH + 1) * sizeof(*xtoviewangle),
+                           PU_STATIC, 0);
+
   R_InitData ();
   printf ("\nR_InitData");
 
@@ -741,6 +841,15 @@ void R_Init (void)
   printf ("\nR_InitSkyMap");
   R_InitTranslationTables ();
   printf ("\nR_InitTranslationsTables");
+  R_InitSpanDrawer ();
+  R_InitRenderThreads ();
+
+  columnmajor = M_CheckParm ("-colmajor") != 0;
+
+  if (columnmajor)
+  {
+    printf ("\nR_Init: column-major view buffer");
+  }
 
   framecount = 0;
 }
@@ -778,6 +887,98 @@ R_PointInSubsector
 
 
 
+//
+// R_LerpFixed
+// Positions can be a full map apart, so the delta is done in 64 bits.
+//
+fixed_t R_LerpFixed (fixed_t from, fixed_t to)
+{
+  return from + (fixed_t)((((int64_t)to - from) * interpfrac) >> FRACBITS);
+}
+
+
+//
+// R_LerpAngle
+// Takes the short way around.
+//
+angle_t R_LerpAngle (angle_t from, angle_t to)
+{
+  return from + (angle_t)(((int64_t)(int32_t)(to - from) * interpfrac)
+                          >> FRACBITS);
+}
+
+
+//
+// R_InterpolateSectors
+// Moves the moving floors and ceilings to where they are at interpfrac
+// for the duration of the frame; R_RestoreSectors puts the tic's heights
+// back before the playsim can see them.
+//
+typedef struct
+{
+  sector_t* sector;
+  fixed_t   floorheight;
+  fixed_t   ceilingheight;
+} movedsector_t;
+
+static movedsector_t* movedsectors;
+static int            maxmovedsectors;
+static int            nummovedsectors;
+
+static void R_InterpolateSectors (void)
+{
+  sector_t* sec;
+  int       i;
+
+  nummovedsectors = 0;
+  if (interpfrac >= FRACUNIT)
+  {
+    return;
+  }
+
+  if (maxmovedsectors < numsectors)
+  {
+    maxmovedsectors = numsectors;
+    movedsectors = realloc (movedsectors,
+                            maxmovedsectors * sizeof(*movedsectors));
+    if (!movedsectors)
+    {
+      I_Error ("R_InterpolateSectors: out of memory");
+    }
+  }
+
+  for (i = 0, sec = sectors ; i < numsectors ; i++, sec++)
+  {
+    if (sec->floorheight == sec->oldfloorheight
+        && sec->ceilingheight == sec->oldceilingheight)
+    {
+      continue;
+    }
+
+    movedsectors[nummovedsectors].sector = sec;
+    movedsectors[nummovedsectors].floorheight = sec->floorheight;
+    movedsectors[nummovedsectors].ceilingheight = sec->ceilingheight;
+    nummovedsectors++;
+
+    sec->floorheight = R_LerpFixed (sec->oldfloorheight, sec->floorheight);
+    sec->ceilingheight = R_LerpFixed (sec->oldceilingheight,
+                                      sec->ceilingheight);
+  }
+}
+
+static void R_RestoreSectors (void)
+{
+  int i;
+
+  for (i = 0 ; i < nummovedsectors ; i++)
+  {
+    movedsectors[i].sector->floorheight = movedsectors[i].floorheight;
+    movedsectors[i].sector->ceilingheight = movedsectors[i].ceilingheight;
+  }
+  nummovedsectors = 0;
+}
+
+
 //
 // R_SetupFrame
 //
@@ -786,13 +987,23 @@ void R_SetupFrame (player_t* player)
   int   i;
 
   viewplayer = player;
-  viewx = player->mo->x;
-  viewy = player->mo->y;
-  viewangle = player->mo->angle + viewangleoffset;
+  if (interpfrac < FRACUNIT)
+  {
+    viewx = R_LerpFixed (player->mo->oldx, player->mo->x);
+    viewy = R_LerpFixed (player->mo->oldy, player->mo->y);
+    viewangle = R_LerpAngle (player->mo->oldangle, player->mo->angle)
+                + viewangleoffset;
+    viewz = R_LerpFixed (player->oldviewz, player->viewz);
+  }
+  else
+  {
+    viewx = player->mo->x;
+    viewy = player->mo->y;
+    viewangle = player->mo->angle + viewangleoffset;
+    viewz = player->viewz;
+  }
   extralight = player->extralight;
 
-  viewz = player->viewz;
-
   viewsin = finesine[viewangle >> ANGLETOFINESHIFT];
   viewcos = finecosine[viewangle >> ANGLETOFINESHIFT];
 
@@ -818,16 +1029,64 @@ void R_SetupFrame (player_t* player)
 
   framecount++;
   validcount++;
+
+  R_SetupVertexCache ();
 }
 
 
 
+//
+// R_RecordPeaks
+//
+static int    peakvisplanes;
+static int    peakdrawsegs;
+static int    peakvissprites;
+static int    peakopenings;
+
+static void R_RecordPeaks (void)
+{
+  if (numvisplanes > peakvisplanes)
+  {
+    peakvisplanes = numvisplanes;
+  }
+
+  if (ds_p - drawsegs > peakdrawsegs)
+  {
+    peakdrawsegs = ds_p - drawsegs;
+  }
+
+  if (vissprite_p - vissprites > peakvissprites)
+  {
+    peakvissprites = vissprite_p - vissprites;
+  }
+
+  if (numopenings > peakopenings)
+  {
+    peakopenings = numopenings;
+  }
+}
+
+
+//
+// R_PrintPeaks
+//
+void R_PrintPeaks (void)
+{
+  printf ("R_PrintPeaks: %i visplanes, %i drawsegs, "
+          "%i vissprites, %i openings\n",
+          peakvisplanes, peakdrawsegs, peakvissprites, peakopenings);
+}
+
+
 //
 // R_RenderView
 //
 void R_RenderPlayerView (player_t* player)
 {
+  PROFILE_START (PROF_VIEW);
   R_SetupFrame (player);
+  R_InterpolateSectors ();
+  R_SetupPVS ();
 
   // Clear buffers.
   R_ClearClipSegs ();
@@ -839,17 +1098,43 @@ void R_RenderPlayerView (player_t* player)
   NetUpdate ();
 
   // The head node is the last node output.
+  PROFILE_START (PROF_BSP);
   R_RenderBSPNode (numnodes - 1);
+  PROFILE_STOP (PROF_BSP);
 
   // Check for new console commands.
   NetUpdate ();
 
+  PROFILE_START (PROF_PLANES);
   R_DrawPlanes ();
+  PROFILE_STOP (PROF_PLANES);
 
   // Check for new console commands.
   NetUpdate ();
 
+  PROFILE_START (PROF_MASKED);
   R_DrawMasked ();
+  PROFILE_STOP (PROF_MASKED);
+
+  // Run the queued draws, if threaded.
+  PROFILE_START (PROF_DRAWQUEUE);
+  R_FlushDrawQueue ();
+  PROFILE_STOP (PROF_DRAWQUEUE);
+
+  // A column-major view still has to go to screens[0].
+  if (columnmajor)
+  {
+    R_TransposeBands ();
+  }
+  V_MarkRect (viewwindowx, viewwindowy, scaledviewwidth, viewheight);
+
+  R_RecordPeaks ();
+  R_RestoreSectors ();
+
+  PROFILE_COUNT (PROF_SEGS, ds_p - drawsegs);
+  PROFILE_COUNT (PROF_VISPLANES, numvisplanes);
+  PROFILE_COUNT (PROF_VISSPRITES, vissprite_p - vissprites);
+  PROFILE_STOP (PROF_VIEW);
 
   // Check for new console commands.
   NetUpdate ();
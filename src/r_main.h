@@ -46,6 +46,11 @@ extern fixed_t    projection;
 
 extern int    validcount;
 
+// Bumped by R_SetupFrame for every view drawn.
+extern int    framecount;
+
+extern fixed_t    interpfrac;
+
 extern int    linecount;
 extern int    loopcount;
 
@@ -67,6 +72,11 @@ extern int    loopcount;
 #define LIGHTZSHIFT   20
 
 extern lighttable_t*  scalelight[LIGHTLEVELS][MAXLIGHTSCALE];
+
+// Scales grow with the screen, the light tables
+//  are indexed by the scale a 320 wide screen would have.
+extern fixed_t    lightscalefactor;
+#define R_LightScale(scale) FixedMul ((scale), lightscalefactor)
 extern lighttable_t*  scalelightfixed[MAXLIGHTSCALE];
 extern lighttable_t*  zlight[LIGHTLEVELS][MAXLIGHTZ];
 
@@ -91,7 +101,10 @@ extern  int   detailshift;
 //
 extern void   (*colfunc) (void);
 extern void   (*basecolfunc) (void);
+// Solid wall and sky columns, one per x across a seg or plane.
+extern void   (*wallcolfunc) (void);
 extern void   (*fuzzcolfunc) (void);
+extern void   (*transcolfunc) (void);
 // No shadow effects on floors.
 extern void   (*spanfunc) (void);
 
@@ -127,6 +140,10 @@ R_PointToDist
 ( fixed_t x,
   fixed_t y );
 
+// Cached for the frame, for the map's vertexes only.
+angle_t R_VertexAngle (vertex_t* v);
+fixed_t R_VertexDist (vertex_t* v);
+
 
 fixed_t R_ScaleFromGlobalAngle (angle_t visangle);
 
@@ -135,6 +152,10 @@ R_PointInSubsector
 ( fixed_t x,
   fixed_t y );
 
+// Interpolate between the previous and the current tic by interpfrac.
+fixed_t R_LerpFixed (fixed_t from, fixed_t to);
+angle_t R_LerpAngle (angle_t from, angle_t to);
+
 void
 R_AddPointToBox
 ( int   x,
@@ -156,6 +177,10 @@ void R_Init (void);
 // Called by M_Responder.
 void R_SetViewSize (int blocks, int detail);
 
+// Largest visplane, drawseg, vissprite and opening
+//  counts of any frame so far, printed on exit.
+void R_PrintPeaks (void);
+
 #endif
 //-----------------------------------------------------------------------------
 //
@@ -28,6 +28,7 @@
 #include <string.h>
 
 #include "i_system.h"
+#include "m_profile.h"
 #include "z_zone.h"
 #include "w_wad.h"
 
@@ -52,16 +53,44 @@ planefunction_t   ceilingfunc;
 //
 
 // Here comes the obnoxious "visplane".
-#define MAXVISPLANES  128
-visplane_t    visplanes[MAXVISPLANES];
-visplane_t*   lastvisplane;
+// There is no fixed limit, the table grows when a frame
+//  needs more and keeps that size for the next frames.
+// Planes are allocated in blocks and never move,
+//  floorplane and ceilingplane stay valid while it grows.
+#define INITVISPLANES 128
+static visplane_t** visplanes;
+static int    maxvisplanes;
+int     numvisplanes;
 visplane_t*   floorplane;
 visplane_t*   ceilingplane;
 
-// ?
-#define MAXOPENINGS SCREENWIDTH*64
-short     openings[MAXOPENINGS];
-short*      lastopening;
+// R_FindPlane looks planes up by height, picnum and light.
+// Only the first plane made for each of those goes in,
+//  planes split off by R_CheckPlane are never returned
+//  by R_FindPlane.
+#define VISPLANEHASHSIZE  128
+#define R_VisplaneHash(height, picnum, lightlevel) \
+  ((unsigned) ((picnum) * 3 + (lightlevel) + ((height) >> FRACBITS) * 7) \
+   & (VISPLANEHASHSIZE - 1))
+
+static visplane_t*  visplanehash[VISPLANEHASHSIZE];
+
+// Clip values for drawsegs and masked textures.
+// Kept in a chain of blocks, each twice the size of
+//  the one before, since drawsegs point into them.
+#define INITOPENINGS  (SCREENWIDTH * 64)
+
+typedef struct openingblock_s
+{
+  struct openingblock_s*  next;
+  int     size;
+  short     openings[];
+} openingblock_t;
+
+static openingblock_t*  firstopenings;
+static openingblock_t*  curopenings;
+static short*   lastopening;
+int     numopenings;
 
 
 //
@@ -69,15 +98,15 @@ short*      lastopening;
 //  floorclip starts out SCREENHEIGHT
 //  ceilingclip starts out -1
 //
-short     floorclip[SCREENWIDTH];
-short     ceilingclip[SCREENWIDTH];
+short*      floorclip;
+short*      ceilingclip;
 
 //
 // spanstart holds the start of a plane span
 // initialized to 0 at start
 //
-int     spanstart[SCREENHEIGHT];
-int     spanstop[SCREENHEIGHT];
+int*      spanstart;
+int*      spanstop;
 
 //
 // texture mapping
@@ -85,15 +114,15 @@ int     spanstop[SCREENHEIGHT];
 lighttable_t**    planezlight;
 fixed_t     planeheight;
 
-fixed_t     yslope[SCREENHEIGHT];
-fixed_t     distscale[SCREENWIDTH];
+fixed_t*    yslope;
+fixed_t*    distscale;
 fixed_t     basexscale;
 fixed_t     baseyscale;
 
-fixed_t     cachedheight[SCREENHEIGHT];
-fixed_t     cacheddistance[SCREENHEIGHT];
-fixed_t     cachedxstep[SCREENHEIGHT];
-fixed_t     cachedystep[SCREENHEIGHT];
+fixed_t*    cachedheight;
+fixed_t*    cacheddistance;
+fixed_t*    cachedxstep;
+fixed_t*    cachedystep;
 
 
 
@@ -103,7 +132,19 @@ fixed_t     cachedystep[SCREENHEIGHT];
 //
 void R_InitPlanes (void)
 {
-  // Doh!
+  floorclip = Z_Malloc (SCREENWIDTH * sizeof(*floorclip), PU_STATIC, 0);
+  ceilingclip = Z_Malloc (SCREENWIDTH * sizeof(*ceilingclip), PU_STATIC, 0);
+  distscale = Z_Malloc (SCREENWIDTH * sizeof(*distscale), PU_STATIC, 0);
+
+  spanstart = Z_Malloc (SCREENHEIGHT * sizeof(*spanstart), PU_STATIC, 0);
+  spanstop = Z_Malloc (SCREENHEIGHT * sizeof(*spanstop), PU_STATIC, 0);
+  yslope = Z_Malloc (SCREENHEIGHT * sizeof(*yslope), PU_STATIC, 0);
+
+  cachedheight = Z_Malloc (SCREENHEIGHT * sizeof(*cachedheight), PU_STATIC, 0);
+  cacheddistance = Z_Malloc (SCREENHEIGHT * sizeof(*cacheddistance),
+                             PU_STATIC, 0);
+  cachedxstep = Z_Malloc (SCREENHEIGHT * sizeof(*cachedxstep), PU_STATIC, 0);
+  cachedystep = Z_Malloc (SCREENHEIGHT * sizeof(*cachedystep), PU_STATIC, 0);
 }
 
 
@@ -182,6 +223,98 @@ R_MapPlane
 
   // high or low detail
   spanfunc ();
+  PROFILE_COUNT (PROF_SPANS, 1);
+}
+
+
+//
+// R_NewOpeningBlock
+//
+static openingblock_t* R_NewOpeningBlock (int size)
+{
+  openingblock_t*   block;
+
+  block = malloc (sizeof(*block) + size * sizeof(short));
+
+  if (!block)
+  {
+    I_Error ("R_NewOpeningBlock: no memory for %i openings", size);
+  }
+
+  block->next = NULL;
+  block->size = size;
+
+  return block;
+}
+
+
+//
+// R_NewOpenings
+// Returns room for count clip values,
+//  valid until the next R_ClearPlanes.
+//
+short* R_NewOpenings (int count)
+{
+  short*  openings;
+
+  if (lastopening + count > curopenings->openings + curopenings->size)
+  {
+    if (!curopenings->next)
+    {
+      curopenings->next = R_NewOpeningBlock (curopenings->size * 2);
+    }
+
+    curopenings = curopenings->next;
+    lastopening = curopenings->openings;
+  }
+
+  openings = lastopening;
+  lastopening += count;
+  numopenings += count;
+
+  return openings;
+}
+
+
+//
+// R_NewPlane
+//
+static visplane_t* R_NewPlane (void)
+{
+  visplane_t*   block;
+  unsigned short* rows;
+  int     size;
+  int     i;
+
+  if (numvisplanes == maxvisplanes)
+  {
+    size = maxvisplanes ? maxvisplanes : INITVISPLANES;
+
+    visplanes = realloc (visplanes,
+                         (maxvisplanes + size) * sizeof(*visplanes));
+    block = malloc (size * sizeof(*block));
+
+    // Pads start out zero, only the top ones are set later.
+    rows = calloc (size * 2 * (SCREENWIDTH + 2), sizeof(*rows));
+
+    if (!visplanes || !block || !rows)
+    {
+      I_Error ("R_NewPlane: no memory for %i visplanes",
+               maxvisplanes + size);
+    }
+
+    for (i = 0 ; i < size ; i++)
+    {
+      block->top = rows + 1;
+      rows += SCREENWIDTH + 2;
+      block->bottom = rows + 1;
+      rows += SCREENWIDTH + 2;
+
+      visplanes[maxvisplanes++] = block++;
+    }
+  }
+
+  return visplanes[numvisplanes++];
 }
 
 
@@ -201,11 +334,20 @@ void R_ClearPlanes (void)
     ceilingclip[i] = -1;
   }
 
-  lastvisplane = visplanes;
-  lastopening = openings;
+  numvisplanes = 0;
+  memset (visplanehash, 0, sizeof(visplanehash));
+
+  if (!firstopenings)
+  {
+    firstopenings = R_NewOpeningBlock (INITOPENINGS);
+  }
+
+  curopenings = firstopenings;
+  lastopening = curopenings->openings;
+  numopenings = 0;
 
   // texture calculation
-  memset (cachedheight, 0, sizeof(cachedheight));
+  memset (cachedheight, 0, SCREENHEIGHT * sizeof(*cachedheight));
 
   // left to right mapping
   angle = (viewangle - ANG90) >> ANGLETOFINESHIFT;
@@ -228,6 +370,7 @@ R_FindPlane
   int   lightlevel )
 {
   visplane_t* check;
+  unsigned  hash;
 
   if (picnum == skyflatnum)
   {
@@ -235,28 +378,21 @@ R_FindPlane
     lightlevel = 0;
   }
 
-  for (check = visplanes; check < lastvisplane; check++)
+  hash = R_VisplaneHash (height, picnum, lightlevel);
+
+  for (check = visplanehash[hash] ; check ; check = check->next)
   {
     if (height == check->height
         && picnum == check->picnum
         && lightlevel == check->lightlevel)
     {
-      break;
+      return check;
     }
   }
 
-
-  if (check < lastvisplane)
-  {
-    return check;
-  }
-
-  if (lastvisplane - visplanes == MAXVISPLANES)
-  {
-    I_Error ("R_FindPlane: no more visplanes");
-  }
-
-  lastvisplane++;
+  check = R_NewPlane ();
+  check->next = visplanehash[hash];
+  visplanehash[hash] = check;
 
   check->height = height;
   check->picnum = picnum;
@@ -264,7 +400,7 @@ R_FindPlane
   check->minx = SCREENWIDTH;
   check->maxx = -1;
 
-  memset (check->top, 0xff, sizeof(check->top));
+  memset (check->top, 0xff, SCREENWIDTH * sizeof(*check->top));
 
   return check;
 }
@@ -279,6 +415,7 @@ R_CheckPlane
   int   start,
   int   stop )
 {
+  visplane_t* newpl;
   int   intrl;
   int   intrh;
   int   unionl;
@@ -308,7 +445,7 @@ R_CheckPlane
   }
 
   for (x = intrl ; x <= intrh ; x++)
-    if (pl->top[x] != 0xff)
+    if (pl->top[x] != 0xffff)
     {
       break;
     }
@@ -323,15 +460,16 @@ R_CheckPlane
   }
 
   // make a new visplane
-  lastvisplane->height = pl->height;
-  lastvisplane->picnum = pl->picnum;
-  lastvisplane->lightlevel = pl->lightlevel;
+  newpl = R_NewPlane ();
+  newpl->height = pl->height;
+  newpl->picnum = pl->picnum;
+  newpl->lightlevel = pl->lightlevel;
 
-  pl = lastvisplane++;
+  pl = newpl;
   pl->minx = start;
   pl->maxx = stop;
 
-  memset (pl->top, 0xff, sizeof(pl->top));
+  memset (pl->top, 0xff, SCREENWIDTH * sizeof(*pl->top));
 
   return pl;
 }
@@ -380,27 +518,16 @@ R_MakeSpans
 void R_DrawPlanes (void)
 {
   visplane_t*   pl;
+  int     i;
   int     light;
   int     x;
   int     stop;
   int     angle;
 
-#ifdef RANGECHECK
-  if (ds_p - drawsegs > MAXDRAWSEGS)
-    I_Error ("R_DrawPlanes: drawsegs overflow (%i)",
-             ds_p - drawsegs);
-
-  if (lastvisplane - visplanes > MAXVISPLANES)
-    I_Error ("R_DrawPlanes: visplane overflow (%i)",
-             lastvisplane - visplanes);
-
-  if (lastopening - openings > MAXOPENINGS)
-    I_Error ("R_DrawPlanes: opening overflow (%i)",
-             lastopening - openings);
-#endif
-
-  for (pl = visplanes ; pl < lastvisplane ; pl++)
+  for (i = 0 ; i < numvisplanes ; i++)
   {
+    pl = visplanes[i];
+
     if (pl->minx > pl->maxx)
     {
       continue;
@@ -428,16 +555,16 @@ void R_DrawPlanes (void)
           angle = (viewangle + xtoviewangle[x]) >> ANGLETOSKYSHIFT;
           dc_x = x;
           dc_source = R_GetColumn(skytexture, angle);
-          colfunc ();
+          wallcolfunc ();
+          PROFILE_COUNT (PROF_COLUMNS, 1);
         }
       }
+      R_FlushColumns ();
       continue;
     }
 
     // regular flat
-    ds_source = W_CacheLumpNum(firstflat +
-                               flattranslation[pl->picnum],
-                               PU_STATIC);
+    ds_source = R_GetFlat (flattranslation[pl->picnum]);
 
     planeheight = abs(pl->height - viewz);
     light = (pl->lightlevel >> LIGHTSEGSHIFT) + extralight;
@@ -454,8 +581,8 @@ void R_DrawPlanes (void)
 
     planezlight = zlight[light];
 
-    pl->top[pl->maxx + 1] = 0xff;
-    pl->top[pl->minx - 1] = 0xff;
+    pl->top[pl->maxx + 1] = 0xffff;
+    pl->top[pl->minx - 1] = 0xffff;
 
     stop = pl->maxx + 1;
 
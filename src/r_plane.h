@@ -24,7 +24,10 @@
 #include "r_data.h"
 
 // Visplane related.
-extern  short*    lastopening;
+extern  int   numvisplanes;
+extern  int   numopenings;
+
+short*  R_NewOpenings (int count);
 
 
 typedef void (*planefunction_t) (int top, int bottom);
@@ -32,11 +35,11 @@ typedef void (*planefunction_t) (int top, int bottom);
 extern planefunction_t  floorfunc;
 extern planefunction_t  ceilingfunc_t;
 
-extern short    floorclip[SCREENWIDTH];
-extern short    ceilingclip[SCREENWIDTH];
+extern short*   floorclip;
+extern short*   ceilingclip;
 
-extern fixed_t    yslope[SCREENHEIGHT];
-extern fixed_t    distscale[SCREENWIDTH];
+extern fixed_t*   yslope;
+extern fixed_t*   distscale;
 
 void R_InitPlanes (void);
 void R_ClearPlanes (void);
@@ -0,0 +1,855 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+// $Log:$
+//
+// DESCRIPTION:
+//  Potentially visible set.
+//  The portals are the two-sided linedefs between different sectors;
+//   closed doors count as open, so the set holds for any sector heights.
+//  Sector A sees sector B if some straight line leaves A and crosses
+//   a chain of portals into B.  The chains are followed from every
+//   sector, each portal clipped to the part a line through the first
+//   and the last portal can reach, the way a 2D "vis" tool does.
+//  Sector interiors are taken as transparent, which only adds to the
+//   set, so the result errs on the visible side.
+//  Things are drawn as billboards that can reach out of their sector,
+//   so a sector within sprite reach of a visible one is kept as well.
+//  The set is cached in $HOME/.doompvscache, keyed by a hash of the
+//   map lumps it depends on.
+//
+//-----------------------------------------------------------------------------
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "doomdef.h"
+#include "doomdata.h"
+
+#include "i_system.h"
+#include "m_argv.h"
+#include "m_bbox.h"
+#include "w_wad.h"
+#include "z_zone.h"
+
+#include "r_defs.h"
+#include "r_state.h"
+#include "r_main.h"
+#include "r_pvs.h"
+
+#define PVSCACHE_MAGIC    0x53565044  // "DPVS"
+#define PVSCACHE_VERSION  1
+
+// Slack in map units for rounded seg vertices ("slime trails").
+#define PVSEPSILON        2.0
+
+// Portal steps followed from one sector before giving up
+//  and taking everything it connects to.
+#define PVSBUDGET         (1 << 18)
+
+// Added to the widest sprite for the reach test.
+#define SPRITEREACHSLACK  64
+
+typedef struct
+{
+  uint32_t  magic;
+  uint32_t  version;
+  uint64_t  key;
+  int32_t   numsectors;
+  int32_t   rowbytes;
+} pvscacheheader_t;
+
+// A portal out of a sector.
+typedef struct
+{
+  int       line;
+  int       to;     // sector on the other side
+  double    sign;   // +1 if that sector is left of v1->v2
+} pvsportal_t;
+
+// A clipped portal, and the half plane past it.
+typedef struct
+{
+  double    x1, y1, x2, y2;
+  double    nx, ny, d;  // nx*x + ny*y - d >= 0 beyond the portal
+} pvswindow_t;
+
+bool      pvsactive;
+uint8_t*  pvsnodes;
+uint8_t*  pvssubsectors;
+
+// numsectors rows of rowbytes, bit b of row a set if a sees b.
+static uint8_t* pvsmatrix;
+static int      rowbytes;
+
+static int*         firstportal;  // [numsectors + 1]
+static pvsportal_t* portals;
+static uint8_t*     onpath;       // [numlines]
+
+// Sectors a sprite from another sector may reach into.
+static int*     firstnear;    // [numsectors + 1]
+static int*     nearsectors;
+
+// Sectors using self-referencing lines for special effects;
+//  they can't be placed with portals, so are always kept.
+static uint8_t* selfref;
+
+static uint8_t* relevant;     // [numsectors]
+static int      pvssector;    // viewer sector of relevant[]
+
+static int      steps;
+static bool     overflow;
+
+
+//
+// R_PVSWindow
+// The whole of a portal, stretched by the slack at both ends.
+//
+static void R_PVSWindow (const pvsportal_t* portal, pvswindow_t* w)
+{
+  const line_t* line = &lines[portal->line];
+  double  dx = line->dx / (double)FRACUNIT;
+  double  dy = line->dy / (double)FRACUNIT;
+  double  len = sqrt (dx * dx + dy * dy);
+  double  ex = 0;
+  double  ey = 0;
+
+  if (len > 0)
+  {
+    ex = dx / len * PVSEPSILON;
+    ey = dy / len * PVSEPSILON;
+    w->nx = -dy / len * portal->sign;
+    w->ny = dx / len * portal->sign;
+  }
+  else
+  {
+    w->nx = w->ny = 0;
+  }
+
+  w->x1 = line->v1->x / (double)FRACUNIT - ex;
+  w->y1 = line->v1->y / (double)FRACUNIT - ey;
+  w->x2 = line->v2->x / (double)FRACUNIT + ex;
+  w->y2 = line->v2->y / (double)FRACUNIT + ey;
+  w->d = w->nx * line->v1->x / (double)FRACUNIT
+         + w->ny * line->v1->y / (double)FRACUNIT;
+}
+
+
+//
+// R_PVSClip
+// Keeps the part of w where nx*x + ny*y - d >= -PVSEPSILON.
+// Returns false if nothing is left.
+//
+static bool R_PVSClip (pvswindow_t* w, double nx, double ny, double d)
+{
+  double  f1 = nx * w->x1 + ny * w->y1 - d + PVSEPSILON;
+  double  f2 = nx * w->x2 + ny * w->y2 - d + PVSEPSILON;
+  double  t;
+
+  if (f1 >= 0 && f2 >= 0)
+  {
+    return true;
+  }
+  if (f1 < 0 && f2 < 0)
+  {
+    return false;
+  }
+
+  t = f1 / (f1 - f2);
+  if (f1 < 0)
+  {
+    w->x1 += (w->x2 - w->x1) * t;
+    w->y1 += (w->y2 - w->y1) * t;
+  }
+  else
+  {
+    w->x2 = w->x1 + (w->x2 - w->x1) * t;
+    w->y2 = w->y1 + (w->y2 - w->y1) * t;
+  }
+  return true;
+}
+
+
+//
+// R_PVSSeparators
+// Clips target to what lines through source and pass can reach.
+// A line from an end of source to an end of pass bounds that region
+//  when the other two ends are on opposite sides of it.
+//
+static bool
+R_PVSSeparators
+( const pvswindow_t*  source,
+  const pvswindow_t*  pass,
+  pvswindow_t*        target )
+{
+  double  sx[2] = { source->x1, source->x2 };
+  double  sy[2] = { source->y1, source->y2 };
+  double  px[2] = { pass->x1, pass->x2 };
+  double  py[2] = { pass->y1, pass->y2 };
+  double  dx, dy, len, nx, ny, d, sa, sb;
+  int     i, j;
+
+  for (i = 0 ; i < 2 ; i++)
+  {
+    for (j = 0 ; j < 2 ; j++)
+    {
+      dx = px[j] - sx[i];
+      dy = py[j] - sy[i];
+      len = sqrt (dx * dx + dy * dy);
+      if (len < PVSEPSILON)
+      {
+        continue;
+      }
+
+      nx = -dy / len;
+      ny = dx / len;
+      d = nx * sx[i] + ny * sy[i];
+      sa = nx * sx[i ^ 1] + ny * sy[i ^ 1] - d;
+      sb = nx * px[j ^ 1] + ny * py[j ^ 1] - d;
+
+      if (sa > PVSEPSILON && sb < -PVSEPSILON)
+      {
+        if (!R_PVSClip (target, -nx, -ny, -d))
+        {
+          return false;
+        }
+      }
+      else if (sa < -PVSEPSILON && sb > PVSEPSILON)
+      {
+        if (!R_PVSClip (target, nx, ny, d))
+        {
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+
+//
+// R_PVSFlow
+// Follows the portals out of sector, seen through source and pass.
+//
+static void
+R_PVSFlow
+( uint8_t*            row,
+  int                 sector,
+  const pvswindow_t*  source,
+  const pvswindow_t*  pass )
+{
+  const pvsportal_t*  portal;
+  pvswindow_t         target;
+  pvswindow_t         newsource;
+  int                 i;
+
+  for (i = firstportal[sector] ; i < firstportal[sector + 1] ; i++)
+  {
+    portal = &portals[i];
+    if (onpath[portal->line])
+    {
+      continue;
+    }
+    if (++steps > PVSBUDGET)
+    {
+      overflow = true;
+      return;
+    }
+
+    // What of the portal a line through source and pass can reach.
+    R_PVSWindow (portal, &target);
+    if (!R_PVSClip (&target, source->nx, source->ny, source->d)
+        || !R_PVSClip (&target, pass->nx, pass->ny, pass->d)
+        || !R_PVSSeparators (source, pass, &target))
+    {
+      continue;
+    }
+
+    // And the part of source such a line can start from.
+    newsource = *source;
+    if (!R_PVSClip (&newsource, -target.nx, -target.ny, -target.d))
+    {
+      continue;
+    }
+
+    row[portal->to >> 3] |= 1 << (portal->to & 7);
+
+    onpath[portal->line] = 1;
+    R_PVSFlow (row, portal->to, &newsource, &target);
+    onpath[portal->line] = 0;
+
+    if (overflow)
+    {
+      return;
+    }
+  }
+}
+
+
+//
+// R_PVSFlood
+// Everything connected to sector, for when the flow runs too long.
+//
+static void R_PVSFlood (uint8_t* row, int sector)
+{
+  int*  stack;
+  int   sp;
+  int   i;
+  int   to;
+
+  stack = Z_Malloc (numsectors * sizeof(*stack), PU_STATIC, NULL);
+  memset (row, 0, rowbytes);
+  row[sector >> 3] |= 1 << (sector & 7);
+  stack[0] = sector;
+  sp = 1;
+
+  while (sp)
+  {
+    sector = stack[--sp];
+    for (i = firstportal[sector] ; i < firstportal[sector + 1] ; i++)
+    {
+      to = portals[i].to;
+      if (!(row[to >> 3] & (1 << (to & 7))))
+      {
+        row[to >> 3] |= 1 << (to & 7);
+        stack[sp++] = to;
+      }
+    }
+  }
+  Z_Free (stack);
+}
+
+
+//
+// R_PVSFromSector
+//
+static void R_PVSFromSector (int sector)
+{
+  uint8_t*            row = pvsmatrix + sector * rowbytes;
+  const pvsportal_t*  portal;
+  pvswindow_t         window;
+  int                 i;
+
+  row[sector >> 3] |= 1 << (sector & 7);
+  steps = 0;
+  overflow = false;
+
+  // Neighbours are seen directly, through the rest of the map
+  //  with the first portal as the source.
+  for (i = firstportal[sector] ; i < firstportal[sector + 1] ; i++)
+  {
+    portal = &portals[i];
+    row[portal->to >> 3] |= 1 << (portal->to & 7);
+
+    R_PVSWindow (portal, &window);
+    onpath[portal->line] = 1;
+    R_PVSFlow (row, portal->to, &window, &window);
+    onpath[portal->line] = 0;
+
+    if (overflow)
+    {
+      R_PVSFlood (row, sector);
+      return;
+    }
+  }
+}
+
+
+//
+// R_PVSCheckMap
+// The PVS relies on every sector being closed by its lines.
+// Returns false if one isn't; also marks self-referencing sectors.
+//
+static bool R_PVSCheckMap (void)
+{
+  int*    count;
+  line_t* line;
+  int     i;
+  int     j;
+  int     v;
+  bool    closed = true;
+
+  count = Z_Malloc (numvertexes * sizeof(*count), PU_STATIC, NULL);
+
+  for (i = 0 ; i < numsectors && closed ; i++)
+  {
+    for (j = 0 ; j < sectors[i].linecount ; j++)
+    {
+      line = sectors[i].lines[j];
+      if (line->frontsector == line->backsector)
+      {
+        selfref[i] = 1;
+        continue;
+      }
+      count[line->v1 - vertexes] = 0;
+      count[line->v2 - vertexes] = 0;
+    }
+    for (j = 0 ; j < sectors[i].linecount ; j++)
+    {
+      line = sectors[i].lines[j];
+      if (line->frontsector != line->backsector)
+      {
+        count[line->v1 - vertexes]++;
+        count[line->v2 - vertexes]++;
+      }
+    }
+    for (j = 0 ; j < sectors[i].linecount ; j++)
+    {
+      line = sectors[i].lines[j];
+      if (line->frontsector == line->backsector)
+      {
+        continue;
+      }
+      v = line->v1 - vertexes;
+      if (count[v] & 1)
+      {
+        closed = false;
+      }
+      v = line->v2 - vertexes;
+      if (count[v] & 1)
+      {
+        closed = false;
+      }
+    }
+  }
+
+  Z_Free (count);
+  return closed;
+}
+
+
+//
+// R_PVSPortals
+// Lists the portals out of each sector.
+//
+static void R_PVSPortals (void)
+{
+  line_t* line;
+  int     numportals;
+  int     i;
+  int     j;
+  int     n;
+
+  numportals = 0;
+  for (i = 0 ; i < numsectors ; i++)
+  {
+    for (j = 0 ; j < sectors[i].linecount ; j++)
+    {
+      line = sectors[i].lines[j];
+      if (line->backsector && line->frontsector != line->backsector)
+      {
+        numportals++;
+      }
+    }
+  }
+
+  firstportal = Z_Malloc ((numsectors + 1) * sizeof(*firstportal),
+                          PU_LEVEL, NULL);
+  portals = Z_Malloc ((numportals + 1) * sizeof(*portals), PU_LEVEL, NULL);
+
+  n = 0;
+  for (i = 0 ; i < numsectors ; i++)
+  {
+    firstportal[i] = n;
+    for (j = 0 ; j < sectors[i].linecount ; j++)
+    {
+      line = sectors[i].lines[j];
+      if (!line->backsector || line->frontsector == line->backsector)
+      {
+        continue;
+      }
+      portals[n].line = line - lines;
+      if (line->frontsector == &sectors[i])
+      {
+        portals[n].to = line->backsector - sectors;
+        portals[n].sign = 1;
+      }
+      else
+      {
+        portals[n].to = line->frontsector - sectors;
+        portals[n].sign = -1;
+      }
+      n++;
+    }
+  }
+  firstportal[numsectors] = n;
+}
+
+
+//
+// R_PVSSpriteReach
+// Lists, for each sector, the sectors whose bounding boxes come within
+//  the widest sprite of its own; a thing in one can be drawn in the other.
+//
+static void R_PVSSpriteReach (void)
+{
+  fixed_t (*box)[4];
+  fixed_t reach;
+  fixed_t r;
+  line_t* line;
+  int     count;
+  int     pass;
+  int     i;
+  int     j;
+
+  reach = 0;
+  for (i = 0 ; i < numspritelumps ; i++)
+  {
+    r = abs (spriteoffset[i]);
+    if (r > reach)
+    {
+      reach = r;
+    }
+    r = abs (spritewidth[i] - spriteoffset[i]);
+    if (r > reach)
+    {
+      reach = r;
+    }
+  }
+  reach += SPRITEREACHSLACK << FRACBITS;
+
+  box = Z_Malloc (numsectors * sizeof(*box), PU_STATIC, NULL);
+  for (i = 0 ; i < numsectors ; i++)
+  {
+    box[i][BOXTOP] = box[i][BOXRIGHT] = INT32_MIN;
+    box[i][BOXBOTTOM] = box[i][BOXLEFT] = INT32_MAX;
+    for (j = 0 ; j < sectors[i].linecount ; j++)
+    {
+      line = sectors[i].lines[j];
+      if (line->bbox[BOXTOP] > box[i][BOXTOP])
+      {
+        box[i][BOXTOP] = line->bbox[BOXTOP];
+      }
+      if (line->bbox[BOXBOTTOM] < box[i][BOXBOTTOM])
+      {
+        box[i][BOXBOTTOM] = line->bbox[BOXBOTTOM];
+      }
+      if (line->bbox[BOXRIGHT] > box[i][BOXRIGHT])
+      {
+        box[i][BOXRIGHT] = line->bbox[BOXRIGHT];
+      }
+      if (line->bbox[BOXLEFT] < box[i][BOXLEFT])
+      {
+        box[i][BOXLEFT] = line->bbox[BOXLEFT];
+      }
+    }
+  }
+
+  // Count, then fill.
+  firstnear = Z_Malloc ((numsectors + 1) * sizeof(*firstnear),
+                        PU_LEVEL, NULL);
+  nearsectors = NULL;
+  for (pass = 0 ; pass < 2 ; pass++)
+  {
+    count = 0;
+    for (i = 0 ; i < numsectors ; i++)
+    {
+      firstnear[i] = count;
+      for (j = 0 ; j < numsectors ; j++)
+      {
+        if (j == i
+            || (int64_t)box[j][BOXLEFT] - box[i][BOXRIGHT] > reach
+            || (int64_t)box[i][BOXLEFT] - box[j][BOXRIGHT] > reach
+            || (int64_t)box[j][BOXBOTTOM] - box[i][BOXTOP] > reach
+            || (int64_t)box[i][BOXBOTTOM] - box[j][BOXTOP] > reach)
+        {
+          continue;
+        }
+        if (nearsectors)
+        {
+          nearsectors[count] = j;
+        }
+        count++;
+      }
+    }
+    firstnear[numsectors] = count;
+
+    if (!nearsectors)
+    {
+      nearsectors = Z_Malloc ((count + 1) * sizeof(*nearsectors),
+                              PU_LEVEL, NULL);
+    }
+  }
+
+  Z_Free (box);
+}
+
+
+//
+// R_PVSCacheKey
+// FNV-1a over the lumps the PVS is made from.
+//
+static uint64_t R_PVSCacheKey (int lumpnum)
+{
+  static const int  maplumps[] =
+  {
+    ML_LINEDEFS, ML_SIDEDEFS, ML_VERTEXES, ML_SECTORS
+  };
+  uint64_t        hash = 0xcbf29ce484222325ULL;
+  const uint8_t*  data;
+  int             size;
+  int             i;
+  int             j;
+
+  for (i = 0 ; i < (int)(sizeof(maplumps) / sizeof(*maplumps)) ; i++)
+  {
+    size = W_LumpLength (lumpnum + maplumps[i]);
+    data = W_CacheLumpNum (lumpnum + maplumps[i], PU_CACHE);
+    for (j = 0 ; j < size ; j++)
+    {
+      hash = (hash ^ data[j]) * 0x100000001b3ULL;
+    }
+  }
+  return hash;
+}
+
+
+//
+// R_PVSCacheName
+// Returns false when the cache should not be used.
+//
+static bool R_PVSCacheName (char* name, size_t size)
+{
+  const char* home = getenv ("HOME");
+
+  if (M_CheckParm ("-nopvscache") || !home)
+  {
+    return false;
+  }
+
+  snprintf (name, size, "%s/.doompvscache", home);
+  return true;
+}
+
+
+//
+// R_LoadPVSCache
+// Looks for this map among the cached ones.
+//
+static bool R_LoadPVSCache (uint64_t key)
+{
+  char              name[1024];
+  FILE*             f;
+  pvscacheheader_t  header;
+  bool              found = false;
+
+  if (!R_PVSCacheName (name, sizeof(name)) || !(f = fopen (name, "rb")))
+  {
+    return false;
+  }
+
+  while (fread (&header, sizeof(header), 1, f) == 1
+         && header.magic == PVSCACHE_MAGIC
+         && header.version == PVSCACHE_VERSION)
+  {
+    if (header.key == key
+        && header.numsectors == numsectors
+        && header.rowbytes == rowbytes)
+    {
+      found = fread (pvsmatrix, rowbytes, numsectors, f)
+              == (size_t)numsectors;
+      break;
+    }
+    if (fseek (f, (long)header.numsectors * header.rowbytes, SEEK_CUR))
+    {
+      break;
+    }
+  }
+
+  fclose (f);
+  return found;
+}
+
+
+//
+// R_SavePVSCache
+// Appends this map to the cache.
+//
+static void R_SavePVSCache (uint64_t key)
+{
+  char              name[1024];
+  FILE*             f;
+  pvscacheheader_t  header;
+
+  if (!R_PVSCacheName (name, sizeof(name)) || !(f = fopen (name, "ab")))
+  {
+    return;
+  }
+
+  header.magic = PVSCACHE_MAGIC;
+  header.version = PVSCACHE_VERSION;
+  header.key = key;
+  header.numsectors = numsectors;
+  header.rowbytes = rowbytes;
+  fwrite (&header, sizeof(header), 1, f);
+  fwrite (pvsmatrix, rowbytes, numsectors, f);
+  fclose (f);
+}
+
+
+//
+// R_BuildPVS
+//
+void R_BuildPVS (int lumpnum)
+{
+  uint64_t  key;
+  int       i;
+
+  pvsmatrix = NULL;
+  pvsactive = false;
+  pvssector = -1;
+
+  if (M_CheckParm ("-nopvs") || !numsectors)
+  {
+    return;
+  }
+
+  selfref = Z_Malloc (numsectors, PU_LEVEL, NULL);
+  memset (selfref, 0, numsectors);
+  if (!R_PVSCheckMap ())
+  {
+    return;
+  }
+
+  R_PVSPortals ();
+  R_PVSSpriteReach ();
+
+  rowbytes = (numsectors + 7) >> 3;
+  pvsmatrix = Z_Malloc (numsectors * rowbytes, PU_LEVEL, NULL);
+  relevant = Z_Malloc (numsectors, PU_LEVEL, NULL);
+  pvssubsectors = Z_Malloc (numsubsectors, PU_LEVEL, NULL);
+  pvsnodes = Z_Malloc (numnodes + 1, PU_LEVEL, NULL);
+
+  key = R_PVSCacheKey (lumpnum);
+  if (R_LoadPVSCache (key))
+  {
+    return;
+  }
+
+  memset (pvsmatrix, 0, numsectors * rowbytes);
+  onpath = Z_Malloc (numlines, PU_STATIC, NULL);
+  memset (onpath, 0, numlines);
+
+  for (i = 0 ; i < numsectors ; i++)
+  {
+    R_PVSFromSector (i);
+  }
+
+  Z_Free (onpath);
+  onpath = NULL;
+
+  R_SavePVSCache (key);
+}
+
+
+//
+// R_PVSMarkNode
+// A node is kept if anything under it is.
+//
+static bool R_PVSMarkNode (int bspnum)
+{
+  node_t* node;
+  bool    left;
+  bool    right;
+
+  if (bspnum & NF_SUBSECTOR)
+  {
+    return pvssubsectors[bspnum == -1 ? 0 : bspnum & ~NF_SUBSECTOR];
+  }
+
+  node = &nodes[bspnum];
+  right = R_PVSMarkNode (node->children[0]);
+  left = R_PVSMarkNode (node->children[1]);
+  pvsnodes[bspnum] = right || left;
+  return pvsnodes[bspnum];
+}
+
+
+//
+// R_PVSMarkSector
+// Works out what to keep for a viewer in sector.
+//
+static void R_PVSMarkSector (int sector)
+{
+  const uint8_t*  row = pvsmatrix + sector * rowbytes;
+  int             i;
+  int             j;
+
+  memcpy (relevant, selfref, numsectors);
+  for (i = 0 ; i < numsectors ; i++)
+  {
+    if (!(row[i >> 3] & (1 << (i & 7))))
+    {
+      continue;
+    }
+    relevant[i] = 1;
+    for (j = firstnear[i] ; j < firstnear[i + 1] ; j++)
+    {
+      relevant[nearsectors[j]] = 1;
+    }
+  }
+
+  for (i = 0 ; i < numsubsectors ; i++)
+  {
+    pvssubsectors[i] = relevant[subsectors[i].sector - sectors];
+  }
+  R_PVSMarkNode (numnodes - 1);
+
+  pvssector = sector;
+}
+
+
+//
+// R_SetupPVS
+//
+void R_SetupPVS (void)
+{
+  subsector_t*  sub;
+  int           sector;
+  int           i;
+
+  pvsactive = false;
+  if (!pvsmatrix)
+  {
+    return;
+  }
+
+  // The set only holds for a viewer inside the sector,
+  //  not one in the void behind its walls (noclip).
+  sub = R_PointInSubsector (viewx, viewy);
+  for (i = 0 ; i < sub->numlines ; i++)
+  {
+    if (R_PointOnSegSide (viewx, viewy, &segs[sub->firstline + i]))
+    {
+      return;
+    }
+  }
+
+  sector = sub->sector - sectors;
+  if (selfref[sector])
+  {
+    return;
+  }
+
+  if (sector != pvssector)
+  {
+    R_PVSMarkSector (sector);
+  }
+  pvsactive = true;
+}
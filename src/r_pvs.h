@@ -0,0 +1,44 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+// DESCRIPTION:
+//  Refresh, potentially visible set used to prune the BSP walk.
+//
+//-----------------------------------------------------------------------------
+#ifndef __R_PVS__
+#define __R_PVS__
+
+// True when the current frame may skip what the PVS rules out.
+extern bool     pvsactive;
+
+// Per node and per subsector, nonzero if it may contribute
+//  to the frame; valid while pvsactive.
+extern uint8_t* pvsnodes;
+extern uint8_t* pvssubsectors;
+
+// Called by P_SetupLevel after P_GroupLines.
+// Loads the map's PVS from the cache or computes it.
+void R_BuildPVS (int lumpnum);
+
+// Called by R_RenderPlayerView after R_SetupFrame.
+void R_SetupPVS (void);
+
+#endif
+//-----------------------------------------------------------------------------
+//
+// $Log:$
+//
+//-----------------------------------------------------------------------------
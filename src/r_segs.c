@@ -27,6 +27,7 @@
 #include <limits.h>
 
 #include "i_system.h"
+#include "m_profile.h"
 
 #include "doomdef.h"
 #include "doomstat.h"
@@ -177,7 +178,7 @@ R_RenderMaskedSegRange
     {
       if (!fixedcolormap)
       {
-        index = spryscale >> LIGHTSCALESHIFT;
+        index = R_LightScale (spryscale) >> LIGHTSCALESHIFT;
 
         if (index >=  MAXLIGHTSCALE )
         {
@@ -199,7 +200,6 @@ R_RenderMaskedSegRange
     }
     spryscale += rw_scalestep;
   }
-
 }
 
 
@@ -287,7 +287,7 @@ void R_RenderSegLoop (void)
       texturecolumn = rw_offset - FixedMul(finetangent[angle], rw_distance);
       texturecolumn >>= FRACBITS;
       // calculate lighting
-      index = rw_scale >> LIGHTSCALESHIFT;
+      index = R_LightScale (rw_scale) >> LIGHTSCALESHIFT;
 
       if (index >=  MAXLIGHTSCALE )
       {
@@ -307,7 +307,8 @@ void R_RenderSegLoop (void)
       dc_yh = yh;
       dc_texturemid = rw_midtexturemid;
       dc_source = R_GetColumn(midtexture, texturecolumn);
-      colfunc ();
+      wallcolfunc ();
+      PROFILE_COUNT (PROF_COLUMNS, 1);
       ceilingclip[rw_x] = viewheight;
       floorclip[rw_x] = -1;
     }
@@ -332,6 +333,7 @@ void R_RenderSegLoop (void)
           dc_texturemid = rw_toptexturemid;
           dc_source = R_GetColumn(toptexture, texturecolumn);
           colfunc ();
+          PROFILE_COUNT (PROF_COLUMNS, 1);
           ceilingclip[rw_x] = mid;
         }
         else
@@ -368,6 +370,7 @@ void R_RenderSegLoop (void)
           dc_source = R_GetColumn(bottomtexture,
                                   texturecolumn);
           colfunc ();
+          PROFILE_COUNT (PROF_COLUMNS, 1);
           floorclip[rw_x] = mid;
         }
         else
@@ -396,6 +399,8 @@ void R_RenderSegLoop (void)
     topfrac += topstep;
     bottomfrac += bottomstep;
   }
+
+  R_FlushColumns ();
 }
 
 
@@ -417,10 +422,10 @@ R_StoreWallRange
   fixed_t   vtop;
   int     lightnum;
 
-  // don't overflow and crash
-  if (ds_p == &drawsegs[MAXDRAWSEGS])
+  // make room for another drawseg
+  if (ds_p == drawsegs + maxdrawsegs)
   {
-    return;
+    R_GrowDrawSegs ();
   }
 
 #ifdef RANGECHECK
@@ -446,7 +451,7 @@ R_StoreWallRange
   }
 
   distangle = ANG90 - offsetangle;
-  hyp = R_PointToDist (curline->v1->x, curline->v1->y);
+  hyp = R_VertexDist (curline->v1);
   sineval = finesine[distangle >> ANGLETOFINESHIFT];
   rw_distance = FixedMul (hyp, sineval);
 
@@ -636,8 +641,8 @@ R_StoreWallRange
     {
       // masked midtexture
       maskedtexture = true;
-      ds_p->maskedtexturecol = maskedtexturecol = lastopening - rw_x;
-      lastopening += rw_stopx - rw_x;
+      ds_p->maskedtexturecol = maskedtexturecol =
+        R_NewOpenings (rw_stopx - rw_x) - rw_x;
     }
   }
 
@@ -766,17 +771,17 @@ R_StoreWallRange
   if ( ((ds_p->silhouette & SIL_TOP) || maskedtexture)
        && !ds_p->sprtopclip)
   {
-    memcpy (lastopening, ceilingclip + start, 2 * (rw_stopx - start));
-    ds_p->sprtopclip = lastopening - start;
-    lastopening += rw_stopx - start;
+    ds_p->sprtopclip = R_NewOpenings (rw_stopx - start) - start;
+    memcpy (ds_p->sprtopclip + start, ceilingclip + start,
+            2 * (rw_stopx - start));
   }
 
   if ( ((ds_p->silhouette & SIL_BOTTOM) || maskedtexture)
        && !ds_p->sprbottomclip)
   {
-    memcpy (lastopening, floorclip + start, 2 * (rw_stopx - start));
-    ds_p->sprbottomclip = lastopening - start;
-    lastopening += rw_stopx - start;
+    ds_p->sprbottomclip = R_NewOpenings (rw_stopx - start) - start;
+    memcpy (ds_p->sprbottomclip + start, floorclip + start,
+            2 * (rw_stopx - start));
   }
 
   if (maskedtexture && !(ds_p->silhouette & SIL_TOP))
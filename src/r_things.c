@@ -32,6 +32,7 @@
 #include "m_swap.h"
 
 #include "i_system.h"
+#include "m_profile.h"
 #include "z_zone.h"
 #include "w_wad.h"
 
@@ -42,6 +43,7 @@
 #include "r_things.h"
 #include "r_main.h"
 #include "r_segs.h"
+#include "v_patch.h"
 
 #include "doomstat.h"
 
@@ -77,8 +79,12 @@ lighttable_t**  spritelights;
 
 // constant arrays
 //  used for psprite clipping and initializing clipping
-short   negonearray[SCREENWIDTH];
-short   screenheightarray[SCREENWIDTH];
+short*    negonearray;
+short*    screenheightarray;
+
+// Sprite clipping, filled per sprite in R_DrawSprite.
+static short* clipbot;
+static short* cliptop;
 
 
 //
@@ -295,8 +301,11 @@ void R_InitSpriteDefs (char** namelist)
 //
 // GAME FUNCTIONS
 //
-vissprite_t vissprites[MAXVISSPRITES];
+// Grows as needed and keeps its size between frames.
+#define INITVISSPRITES  128
+vissprite_t*  vissprites;
 vissprite_t*  vissprite_p;
+int   maxvissprites;
 int   newvissprite;
 
 
@@ -309,6 +318,11 @@ void R_InitSprites (char** namelist)
 {
   int   i;
 
+  negonearray = Z_Malloc (SCREENWIDTH * sizeof(short), PU_STATIC, 0);
+  screenheightarray = Z_Malloc (SCREENWIDTH * sizeof(short), PU_STATIC, 0);
+  clipbot = Z_Malloc (SCREENWIDTH * sizeof(short), PU_STATIC, 0);
+  cliptop = Z_Malloc (SCREENWIDTH * sizeof(short), PU_STATIC, 0);
+
   for (i = 0 ; i < SCREENWIDTH ; i++)
   {
     negonearray[i] = -1;
@@ -332,13 +346,23 @@ void R_ClearSprites (void)
 //
 // R_NewVisSprite
 //
-vissprite_t overflowsprite;
-
 vissprite_t* R_NewVisSprite (void)
 {
-  if (vissprite_p == &vissprites[MAXVISSPRITES])
+  int   count;
+
+  if (vissprite_p == vissprites + maxvissprites)
   {
-    return &overflowsprite;
+    count = vissprite_p - vissprites;
+    maxvissprites = maxvissprites ? maxvissprites * 2 : INITVISSPRITES;
+    vissprites = realloc (vissprites, maxvissprites * sizeof(*vissprites));
+
+    if (!vissprites)
+    {
+      I_Error ("R_NewVisSprite: no memory for %i vissprites",
+               maxvissprites);
+    }
+
+    vissprite_p = vissprites + count;
   }
 
   vissprite_p++;
@@ -359,43 +383,86 @@ short*    mceilingclip;
 fixed_t   spryscale;
 fixed_t   sprtopscreen;
 
-void R_DrawMaskedColumn (column_t* column)
+//
+// R_DrawMaskedPost
+// Clips the rows top to top + length - 1 of a column
+//  against the sprite clips and draws them;
+//  basetexturemid is the texture row 0.
+//
+static void
+R_DrawMaskedPost
+( int   top,
+  int   length,
+  uint8_t*   source,
+  fixed_t basetexturemid )
 {
   int   topscreen;
   int   bottomscreen;
+
+  // calculate unclipped screen coordinates
+  //  for post
+  topscreen = sprtopscreen + spryscale * top;
+  bottomscreen = topscreen + spryscale * length;
+
+  dc_yl = (topscreen + FRACUNIT - 1) >> FRACBITS;
+  dc_yh = (bottomscreen - 1) >> FRACBITS;
+
+  if (dc_yh >= mfloorclip[dc_x])
+  {
+    dc_yh = mfloorclip[dc_x] - 1;
+  }
+  if (dc_yl <= mceilingclip[dc_x])
+  {
+    dc_yl = mceilingclip[dc_x] + 1;
+  }
+
+  if (dc_yl <= dc_yh)
+  {
+    dc_source = source;
+    dc_texturemid = basetexturemid - (top << FRACBITS);
+
+    // Drawn by either R_DrawColumn
+    //  or (SHADOW) R_DrawFuzzColumn.
+    colfunc ();
+    PROFILE_COUNT (PROF_COLUMNS, 1);
+  }
+}
+
+void R_DrawMaskedColumn (column_t* column)
+{
   fixed_t basetexturemid;
 
   basetexturemid = dc_texturemid;
 
   for ( ; column->topdelta != 0xff ; )
   {
-    // calculate unclipped screen coordinates
-    //  for post
-    topscreen = sprtopscreen + spryscale * column->topdelta;
-    bottomscreen = topscreen + spryscale * column->length;
+    R_DrawMaskedPost (column->topdelta, column->length,
+                      (uint8_t*)column + 3, basetexturemid);
+    column = (column_t*)(  (uint8_t*)column + column->length + 4);
+  }
 
-    dc_yl = (topscreen + FRACUNIT - 1) >> FRACBITS;
-    dc_yh = (bottomscreen - 1) >> FRACBITS;
+  dc_texturemid = basetexturemid;
+}
 
-    if (dc_yh >= mfloorclip[dc_x])
-    {
-      dc_yh = mfloorclip[dc_x] - 1;
-    }
-    if (dc_yl <= mceilingclip[dc_x])
-    {
-      dc_yl = mceilingclip[dc_x] + 1;
-    }
 
-    if (dc_yl <= dc_yh)
-    {
-      dc_source = (uint8_t*)column + 3;
-      dc_texturemid = basetexturemid - (column->topdelta << FRACBITS);
+//
+// R_DrawPatchColumn
+// R_DrawMaskedColumn for a column of a converted patch.
+//
+static void R_DrawPatchColumn (vpatch_t* patch, int col)
+{
+  vpost_t*  post;
+  vpost_t*  end;
+  fixed_t   basetexturemid;
 
-      // Drawn by either R_DrawColumn
-      //  or (SHADOW) R_DrawFuzzColumn.
-      colfunc ();
-    }
-    column = (column_t*)(  (uint8_t*)column + column->length + 4);
+  basetexturemid = dc_texturemid;
+  post = patch->posts + patch->columns[col];
+  end = patch->posts + patch->columns[col + 1];
+
+  for ( ; post < end ; post++)
+  {
+    R_DrawMaskedPost (post->top, post->length,
+                      patch->pixels + post->pixels, basetexturemid);
   }
 
   dc_texturemid = basetexturemid;
@@ -413,13 +480,12 @@ R_DrawVisSprite
   int     x1,
   int     x2 )
 {
-  column_t*   column;
   int     texturecolumn;
   fixed_t   frac;
-  patch_t*    patch;
+  vpatch_t*   patch;
 
 
-  patch = W_CacheLumpNum (vis->patch + firstspritelump, PU_CACHE);
+  patch = V_CachePatchNum (vis->patch + firstspritelump);
 
   dc_colormap = vis->colormap;
 
@@ -430,7 +496,7 @@ R_DrawVisSprite
   }
   else if (vis->mobjflags & MF_TRANSLATION)
   {
-    colfunc = R_DrawTranslatedColumn;
+    colfunc = transcolfunc;
     dc_translation = translationtables - 256 +
                      ( (vis->mobjflags & MF_TRANSLATION) >> (MF_TRANSSHIFT - 8) );
   }
@@ -445,14 +511,12 @@ R_DrawVisSprite
   {
     texturecolumn = frac >> FRACBITS;
 #ifdef RANGECHECK
-    if (texturecolumn < 0 || texturecolumn >= SHORT(patch->width))
+    if (texturecolumn < 0 || texturecolumn >= patch->width)
     {
       I_Error ("R_DrawSpriteRange: bad texturecolumn");
     }
 #endif
-    column = (column_t*) ((uint8_t*)patch +
-                          LONG(patch->columnofs[texturecolumn]));
-    R_DrawMaskedColumn (column);
+    R_DrawPatchColumn (patch, texturecolumn);
   }
 
   colfunc = basecolfunc;
@@ -495,9 +559,28 @@ void R_ProjectSprite (mobj_t* thing)
   angle_t   ang;
   fixed_t   iscale;
 
+  fixed_t   thingx;
+  fixed_t   thingy;
+  fixed_t   thingz;
+
+  // where the thing is at this frame; the angle only picks
+  // one of eight rotations, so it is left as is
+  if (interpfrac < FRACUNIT)
+  {
+    thingx = R_LerpFixed (thing->oldx, thing->x);
+    thingy = R_LerpFixed (thing->oldy, thing->y);
+    thingz = R_LerpFixed (thing->oldz, thing->z);
+  }
+  else
+  {
+    thingx = thing->x;
+    thingy = thing->y;
+    thingz = thing->z;
+  }
+
   // transform the origin point
-  tr_x = thing->x - viewx;
-  tr_y = thing->y - viewy;
+  tr_x = thingx - viewx;
+  tr_y = thingy - viewy;
 
   gxt = FixedMul(tr_x, viewcos);
   gyt = -FixedMul(tr_y, viewsin);
@@ -539,7 +622,7 @@ void R_ProjectSprite (mobj_t* thing)
   if (sprframe->rotate)
   {
     // choose a different rotation based on player view
-    ang = R_PointToAngle (thing->x, thing->y);
+    ang = R_PointToAngle (thingx, thingy);
     rot = (ang - thing->angle + (unsigned)(ANG45 / 2) * 9) >> 29;
     lump = sprframe->lump[rot];
     flip = (bool)sprframe->flip[rot];
@@ -574,10 +657,10 @@ void R_ProjectSprite (mobj_t* thing)
   vis = R_NewVisSprite ();
   vis->mobjflags = thing->flags;
   vis->scale = xscale << detailshift;
-  vis->gx = thing->x;
-  vis->gy = thing->y;
-  vis->gz = thing->z;
-  vis->gzt = thing->z + spritetopoffset[lump];
+  vis->gx = thingx;
+  vis->gy = thingy;
+  vis->gz = thingz;
+  vis->gzt = thingz + spritetopoffset[lump];
   vis->texturemid = vis->gzt - viewz;
   vis->x1 = x1 < 0 ? 0 : x1;
   vis->x2 = x2 >= viewwidth ? viewwidth - 1 : x2;
@@ -620,7 +703,7 @@ void R_ProjectSprite (mobj_t* thing)
   else
   {
     // diminished light
-    index = xscale >> (LIGHTSCALESHIFT - detailshift);
+    index = R_LightScale (xscale) >> (LIGHTSCALESHIFT - detailshift);
 
     if (index >= MAXLIGHTSCALE)
     {
@@ -832,174 +915,405 @@ void R_DrawPlayerSprites (void)
 
 //
 // R_SortVisSprites
+// Links the vissprites into vsprsortedhead by increasing
+//  scale, so they draw back to front. The sort is stable:
+//  equal scales keep the order they were projected in,
+//  same as the selection sort this replaced.
+// Short lists use an insertion sort, longer ones a radix
+//  sort on the scale, a byte at a time.
 //
 vissprite_t vsprsortedhead;
 
+// Below this many sprites the insertion sort is faster.
+#define RADIXSORTSPRITES  40
+
+static int*   sortorder;
+static int*   sortbuffer;
+static int    maxsortsprites;
+
+
+static void R_InsertionSortVisSprites (int* order, int count)
+{
+  int     i;
+  int     j;
+  int     index;
+  fixed_t   scale;
+
+  for (i = 1 ; i < count ; i++)
+  {
+    index = order[i];
+    scale = vissprites[index].scale;
+
+    for (j = i ; j > 0 && vissprites[order[j - 1]].scale > scale ; j--)
+    {
+      order[j] = order[j - 1];
+    }
+
+    order[j] = index;
+  }
+}
+
+
+static int* R_RadixSortVisSprites (int* order, int* buffer, int count)
+{
+  int     counts[4][256];
+  int     offset;
+  int     total;
+  int     pass;
+  int     shift;
+  int     i;
+  int*    swap;
+  unsigned  key;
+
+  memset (counts, 0, sizeof(counts));
+
+  // Flipping the sign bit makes signed scales sort as unsigned.
+  for (i = 0 ; i < count ; i++)
+  {
+    key = (unsigned) vissprites[i].scale ^ 0x80000000u;
+    counts[0][key & 0xff]++;
+    counts[1][(key >> 8) & 0xff]++;
+    counts[2][(key >> 16) & 0xff]++;
+    counts[3][key >> 24]++;
+  }
+
+  for (pass = 0 ; pass < 4 ; pass++)
+  {
+    shift = pass * 8;
+
+    // Every key has the same byte here, nothing to do.
+    key = ((unsigned) vissprites[order[0]].scale ^ 0x80000000u) >> shift;
+    if (counts[pass][key & 0xff] == count)
+    {
+      continue;
+    }
+
+    for (i = 0, total = 0 ; i < 256 ; i++)
+    {
+      offset = counts[pass][i];
+      counts[pass][i] = total;
+      total += offset;
+    }
+
+    for (i = 0 ; i < count ; i++)
+    {
+      key = ((unsigned) vissprites[order[i]].scale ^ 0x80000000u) >> shift;
+      buffer[counts[pass][key & 0xff]++] = order[i];
+    }
+
+    swap = order;
+    order = buffer;
+    buffer = swap;
+  }
+
+  return order;
+}
+
 
 void R_SortVisSprites (void)
 {
   int     i;
   int     count;
+  int*    order;
+  vissprite_t*  prev;
   vissprite_t*  ds;
-  vissprite_t*  best;
-  vissprite_t   unsorted;
-  fixed_t   bestscale;
 
   count = vissprite_p - vissprites;
 
-  unsorted.next = unsorted.prev = &unsorted;
+  vsprsortedhead.next = vsprsortedhead.prev = &vsprsortedhead;
 
   if (!count)
   {
     return;
   }
 
-  for (ds = vissprites ; ds < vissprite_p ; ds++)
+  if (count > maxsortsprites)
+  {
+    maxsortsprites = maxvissprites;
+    sortorder = realloc (sortorder, maxsortsprites * sizeof(*sortorder));
+    sortbuffer = realloc (sortbuffer, maxsortsprites * sizeof(*sortbuffer));
+
+    if (!sortorder || !sortbuffer)
+    {
+      I_Error ("R_SortVisSprites: no memory for %i vissprites",
+               maxsortsprites);
+    }
+  }
+
+  for (i = 0 ; i < count ; i++)
   {
-    ds->next = ds + 1;
-    ds->prev = ds - 1;
+    sortorder[i] = i;
   }
 
-  vissprites[0].prev = &unsorted;
-  unsorted.next = &vissprites[0];
-  (vissprite_p - 1)->next = &unsorted;
-  unsorted.prev = vissprite_p - 1;
+  if (count < RADIXSORTSPRITES)
+  {
+    order = sortorder;
+    R_InsertionSortVisSprites (order, count);
+  }
+  else
+  {
+    order = R_RadixSortVisSprites (sortorder, sortbuffer, count);
+  }
+
+  prev = &vsprsortedhead;
 
-  // pull the vissprites out by scale
-  //best = 0;   // shut up the compiler warning
-  vsprsortedhead.next = vsprsortedhead.prev = &vsprsortedhead;
   for (i = 0 ; i < count ; i++)
   {
-    bestscale = INT_MAX;
-    for (ds = unsorted.next ; ds != &unsorted ; ds = ds->next)
-    {
-      if (ds->scale < bestscale)
-      {
-        bestscale = ds->scale;
-        best = ds;
-      }
-    }
-    best->next->prev = best->prev;
-    best->prev->next = best->next;
-    best->next = &vsprsortedhead;
-    best->prev = vsprsortedhead.prev;
-    vsprsortedhead.prev->next = best;
-    vsprsortedhead.prev = best;
+    ds = &vissprites[order[i]];
+    ds->prev = prev;
+    prev->next = ds;
+    prev = ds;
   }
+
+  prev->next = &vsprsortedhead;
+  vsprsortedhead.prev = prev;
 }
 
 
 
 //
-// R_DrawSprite
+// Drawseg buckets.
+// Drawsegs that can clip sprites or have masked mid
+//  textures are listed in every bucket of DSBUCKETWIDTH
+//  columns they overlap, latest first, so R_DrawSprite
+//  only looks at the segs near each sprite.
+// Every column still sees its segs in the order of a
+//  backwards scan over all drawsegs, so the clipping and
+//  masked seg drawing come out the same.
 //
-void R_DrawSprite (vissprite_t* spr)
+#define DSBUCKETSHIFT   5
+#define DSBUCKETWIDTH   (1 << DSBUCKETSHIFT)
+
+// Bucket b holds dsbucketsegs[dsbucketstart[b]]
+//  up to dsbucketsegs[dsbucketstart[b + 1] - 1].
+static int*   dsbucketstart;
+static int*   dsbucketfill;
+static drawseg_t**  dsbucketsegs;
+static int    maxdsbucketsegs;
+
+
+static void R_BucketDrawSegs (void)
 {
   drawseg_t*    ds;
-  short   clipbot[SCREENWIDTH];
-  short   cliptop[SCREENWIDTH];
-  int     x;
-  int     r1;
-  int     r2;
-  fixed_t   scale;
-  fixed_t   lowscale;
-  int     silhouette;
+  int     numbuckets;
+  int     total;
+  int     count;
+  int     b;
 
-  for (x = spr->x1 ; x <= spr->x2 ; x++)
+  numbuckets = (viewwidth + DSBUCKETWIDTH - 1) >> DSBUCKETSHIFT;
+
+  if (!dsbucketstart)
   {
-    clipbot[x] = cliptop[x] = -2;
+    // Sized for the whole screen, views never get wider.
+    b = ((SCREENWIDTH + DSBUCKETWIDTH - 1) >> DSBUCKETSHIFT) + 1;
+    dsbucketstart = malloc (b * sizeof(*dsbucketstart));
+    dsbucketfill = malloc (b * sizeof(*dsbucketfill));
+
+    if (!dsbucketstart || !dsbucketfill)
+    {
+      I_Error ("R_BucketDrawSegs: no memory");
+    }
   }
 
-  // Scan drawsegs from end to start for obscuring segs.
-  // The first drawseg that has a greater scale
-  //  is the clip seg.
-  for (ds = ds_p - 1 ; ds >= drawsegs ; ds--)
+  memset (dsbucketstart, 0, (numbuckets + 1) * sizeof(*dsbucketstart));
+
+  for (ds = drawsegs ; ds < ds_p ; ds++)
   {
-    // determine if the drawseg obscures the sprite
-    if (ds->x1 > spr->x2
-        || ds->x2 < spr->x1
-        || (!ds->silhouette
-            && !ds->maskedtexturecol) )
+    if (!ds->silhouette && !ds->maskedtexturecol)
     {
-      // does not cover sprite
       continue;
     }
 
-    r1 = ds->x1 < spr->x1 ? spr->x1 : ds->x1;
-    r2 = ds->x2 > spr->x2 ? spr->x2 : ds->x2;
-
-    if (ds->scale1 > ds->scale2)
+    for (b = ds->x1 >> DSBUCKETSHIFT ; b <= ds->x2 >> DSBUCKETSHIFT ; b++)
     {
-      lowscale = ds->scale2;
-      scale = ds->scale1;
+      dsbucketstart[b]++;
     }
-    else
+  }
+
+  // Counts to offsets, each bucket fills from its end.
+  for (b = 0, total = 0 ; b < numbuckets ; b++)
+  {
+    count = dsbucketstart[b];
+    dsbucketstart[b] = total;
+    total += count;
+    dsbucketfill[b] = total;
+  }
+
+  dsbucketstart[numbuckets] = total;
+
+  if (total > maxdsbucketsegs)
+  {
+    maxdsbucketsegs = total * 2;
+    dsbucketsegs = realloc (dsbucketsegs,
+                            maxdsbucketsegs * sizeof(*dsbucketsegs));
+
+    if (!dsbucketsegs)
     {
-      lowscale = ds->scale1;
-      scale = ds->scale2;
+      I_Error ("R_BucketDrawSegs: no memory for %i entries",
+               maxdsbucketsegs);
     }
+  }
 
-    if (scale < spr->scale
-        || ( lowscale < spr->scale
-             && !R_PointOnSegSide (spr->gx, spr->gy, ds->curline) ) )
+  for (ds = drawsegs ; ds < ds_p ; ds++)
+  {
+    if (!ds->silhouette && !ds->maskedtexturecol)
     {
-      // masked mid texture?
-      if (ds->maskedtexturecol)
-      {
-        R_RenderMaskedSegRange (ds, r1, r2);
-      }
-      // seg is behind sprite
       continue;
     }
 
+    for (b = ds->x1 >> DSBUCKETSHIFT ; b <= ds->x2 >> DSBUCKETSHIFT ; b++)
+    {
+      dsbucketsegs[--dsbucketfill[b]] = ds;
+    }
+  }
+}
+
+
+
+//
+// R_ClipSpriteToSeg
+// Clips columns r1 to r2 of the sprite to the drawseg,
+//  or draws its masked mid texture if it is behind.
+//
+static void
+R_ClipSpriteToSeg
+( vissprite_t*  spr,
+  drawseg_t*    ds,
+  int     r1,
+  int     r2 )
+{
+  int     x;
+  fixed_t   scale;
+  fixed_t   lowscale;
+  int     silhouette;
 
-    // clip this piece of the sprite
-    silhouette = ds->silhouette;
+  if (ds->scale1 > ds->scale2)
+  {
+    lowscale = ds->scale2;
+    scale = ds->scale1;
+  }
+  else
+  {
+    lowscale = ds->scale1;
+    scale = ds->scale2;
+  }
 
-    if (spr->gz >= ds->bsilheight)
+  if (scale < spr->scale
+      || ( lowscale < spr->scale
+           && !R_PointOnSegSide (spr->gx, spr->gy, ds->curline) ) )
+  {
+    // masked mid texture?
+    if (ds->maskedtexturecol)
     {
-      silhouette &= ~SIL_BOTTOM;
+      R_RenderMaskedSegRange (ds, r1, r2);
     }
+    // seg is behind sprite
+    return;
+  }
+
 
-    if (spr->gzt <= ds->tsilheight)
+  // clip this piece of the sprite
+  silhouette = ds->silhouette;
+
+  if (spr->gz >= ds->bsilheight)
+  {
+    silhouette &= ~SIL_BOTTOM;
+  }
+
+  if (spr->gzt <= ds->tsilheight)
+  {
+    silhouette &= ~SIL_TOP;
+  }
+
+  if (silhouette == 1)
+  {
+    // bottom sil
+    for (x = r1 ; x <= r2 ; x++)
+      if (clipbot[x] == -2)
+      {
+        clipbot[x] = ds->sprbottomclip[x];
+      }
+  }
+  else if (silhouette == 2)
+  {
+    // top sil
+    for (x = r1 ; x <= r2 ; x++)
+      if (cliptop[x] == -2)
+      {
+        cliptop[x] = ds->sprtopclip[x];
+      }
+  }
+  else if (silhouette == 3)
+  {
+    // both
+    for (x = r1 ; x <= r2 ; x++)
     {
-      silhouette &= ~SIL_TOP;
+      if (clipbot[x] == -2)
+      {
+        clipbot[x] = ds->sprbottomclip[x];
+      }
+      if (cliptop[x] == -2)
+      {
+        cliptop[x] = ds->sprtopclip[x];
+      }
     }
+  }
+}
+
+
+
+//
+// R_DrawSprite
+//
+void R_DrawSprite (vissprite_t* spr)
+{
+  drawseg_t*    ds;
+  int     x;
+  int     b;
+  int     bx1;
+  int     bx2;
+  int     i;
+
+  for (x = spr->x1 ; x <= spr->x2 ; x++)
+  {
+    clipbot[x] = cliptop[x] = -2;
+  }
+
+  // Scan the drawsegs from end to start for obscuring segs,
+  //  one bucket of the sprite's columns at a time.
+  // The first drawseg that has a greater scale
+  //  is the clip seg.
+  for (b = spr->x1 >> DSBUCKETSHIFT ; b <= spr->x2 >> DSBUCKETSHIFT ; b++)
+  {
+    bx1 = b << DSBUCKETSHIFT;
+    bx2 = bx1 + DSBUCKETWIDTH - 1;
 
-    if (silhouette == 1)
+    if (bx1 < spr->x1)
     {
-      // bottom sil
-      for (x = r1 ; x <= r2 ; x++)
-        if (clipbot[x] == -2)
-        {
-          clipbot[x] = ds->sprbottomclip[x];
-        }
+      bx1 = spr->x1;
     }
-    else if (silhouette == 2)
+
+    if (bx2 > spr->x2)
     {
-      // top sil
-      for (x = r1 ; x <= r2 ; x++)
-        if (cliptop[x] == -2)
-        {
-          cliptop[x] = ds->sprtopclip[x];
-        }
+      bx2 = spr->x2;
     }
-    else if (silhouette == 3)
+
+    for (i = dsbucketstart[b] ; i < dsbucketstart[b + 1] ; i++)
     {
-      // both
-      for (x = r1 ; x <= r2 ; x++)
+      ds = dsbucketsegs[i];
+
+      // determine if the drawseg obscures the sprite
+      if (ds->x1 > bx2 || ds->x2 < bx1)
       {
-        if (clipbot[x] == -2)
-        {
-          clipbot[x] = ds->sprbottomclip[x];
-        }
-        if (cliptop[x] == -2)
-        {
-          cliptop[x] = ds->sprtopclip[x];
-        }
+        // does not cover sprite
+        continue;
       }
-    }
 
+      R_ClipSpriteToSeg (spr,
+                         ds,
+                         ds->x1 < bx1 ? bx1 : ds->x1,
+                         ds->x2 > bx2 ? bx2 : ds->x2);
+    }
   }
 
   // all clipping has been performed, so draw the sprite
@@ -1038,6 +1352,8 @@ void R_DrawMasked (void)
 
   if (vissprite_p > vissprites)
   {
+    R_BucketDrawSegs ();
+
     // draw all vissprites back to front
     for (spr = vsprsortedhead.next ;
          spr != &vsprsortedhead ;
@@ -21,16 +21,15 @@
 #ifndef __R_THINGS__
 #define __R_THINGS__
 
-#define MAXVISSPRITES   128
-
-extern vissprite_t  vissprites[MAXVISSPRITES];
+extern vissprite_t* vissprites;
 extern vissprite_t* vissprite_p;
+extern int    maxvissprites;
 extern vissprite_t  vsprsortedhead;
 
 // Constant arrays used for psprite clipping
 //  and initializing clipping.
-extern short    negonearray[SCREENWIDTH];
-extern short    screenheightarray[SCREENWIDTH];
+extern short*   negonearray;
+extern short*   screenheightarray;
 
 // vars for R_DrawMaskedColumn
 extern short*   mfloorclip;
@@ -0,0 +1,382 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+// $Log:$
+//
+// DESCRIPTION:
+//  Multithreaded refresh.
+//  The BSP walk, clipping and plane setup run once over the
+//   full view, exactly as with a single thread, but every
+//   column and span draw is queued instead of executed.
+//  At the end of the frame the view is split into vertical
+//   column bands and each worker replays the whole queue,
+//   clipped to its band.
+//  Spans crossing a band edge are advanced by whole steps,
+//   so the output is identical to drawing on one thread.
+//
+//-----------------------------------------------------------------------------
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "doomdef.h"
+
+#include "i_system.h"
+#include "i_thread.h"
+#include "m_argv.h"
+#include "z_zone.h"
+
+#include "r_defs.h"
+#include "r_main.h"
+#include "r_draw.h"
+#include "r_thread.h"
+
+int   numrenderthreads = 1;
+
+//
+// A queued column or span draw,
+//  i.e. the dc_* or ds_* parameters at the time of the call.
+//
+typedef struct
+{
+  void    (*func) (void);
+  bool    span;
+
+  lighttable_t* colormap;
+  uint8_t*      source;
+
+  // dc_x, dc_x, dc_yl, dc_yh or ds_x1, ds_x2, ds_y, ds_y.
+  int     x1;
+  int     x2;
+  int     y1;
+  int     y2;
+
+  // dc_texturemid, dc_iscale or ds_xfrac, ds_xstep.
+  fixed_t frac;
+  fixed_t step;
+
+  // Spans only.
+  fixed_t yfrac;
+  fixed_t ystep;
+
+  // Columns only.
+  uint8_t*  translation;
+  int     fuzzpos;
+} drawcmd_t;
+
+static drawcmd_t* drawcmds;
+static int    numdrawcmds;
+static int    maxdrawcmds;
+
+
+//
+// R_InitRenderThreads
+//
+void R_InitRenderThreads (void)
+{
+  int   p;
+
+  p = M_CheckParm ("-rthreads");
+
+  if (p && p < myargc - 1)
+  {
+    numrenderthreads = atoi (myargv[p + 1]);
+
+    if (numrenderthreads < 1)
+    {
+      numrenderthreads = 1;
+    }
+    else if (numrenderthreads > MAXWORKERS)
+    {
+      numrenderthreads = MAXWORKERS;
+    }
+  }
+
+  if (numrenderthreads > 1)
+  {
+    printf ("\nR_InitRenderThreads: %i column bands", numrenderthreads);
+    Z_SetPurgeHook (R_FlushDrawQueue);
+  }
+}
+
+
+//
+// Copying the drawer parameters in and out of a command.
+//
+static void R_SaveColumn (drawcmd_t* cmd)
+{
+  cmd->span = false;
+  cmd->colormap = dc_colormap;
+  cmd->source = dc_source;
+  cmd->x1 = cmd->x2 = dc_x;
+  cmd->y1 = dc_yl;
+  cmd->y2 = dc_yh;
+  cmd->frac = dc_texturemid;
+  cmd->step = dc_iscale;
+  cmd->translation = dc_translation;
+  cmd->fuzzpos = fuzzpos;
+}
+
+static void R_LoadColumn (const drawcmd_t* cmd)
+{
+  dc_colormap = cmd->colormap;
+  dc_source = cmd->source;
+  dc_x = cmd->x1;
+  dc_yl = cmd->y1;
+  dc_yh = cmd->y2;
+  dc_texturemid = cmd->frac;
+  dc_iscale = cmd->step;
+  dc_translation = cmd->translation;
+  fuzzpos = cmd->fuzzpos;
+}
+
+static void R_SaveSpan (drawcmd_t* cmd)
+{
+  cmd->span = true;
+  cmd->colormap = ds_colormap;
+  cmd->source = ds_source;
+  cmd->x1 = ds_x1;
+  cmd->x2 = ds_x2;
+  cmd->y1 = cmd->y2 = ds_y;
+  cmd->frac = ds_xfrac;
+  cmd->step = ds_xstep;
+  cmd->yfrac = ds_yfrac;
+  cmd->ystep = ds_ystep;
+}
+
+static void R_LoadSpan (const drawcmd_t* cmd)
+{
+  ds_colormap = cmd->colormap;
+  ds_source = cmd->source;
+  ds_x1 = cmd->x1;
+  ds_x2 = cmd->x2;
+  ds_y = cmd->y1;
+  ds_xfrac = cmd->frac;
+  ds_xstep = cmd->step;
+  ds_yfrac = cmd->yfrac;
+  ds_ystep = cmd->ystep;
+}
+
+
+//
+// R_NewDrawCmd
+// The queue keeps its size between frames.
+//
+static drawcmd_t* R_NewDrawCmd (void)
+{
+  if (numdrawcmds == maxdrawcmds)
+  {
+    maxdrawcmds = maxdrawcmds ? maxdrawcmds * 2 : 4096;
+    drawcmds = realloc (drawcmds, maxdrawcmds * sizeof(*drawcmds));
+
+    if (!drawcmds)
+    {
+      I_Error ("R_NewDrawCmd: no memory for %i draws", maxdrawcmds);
+    }
+  }
+
+  return &drawcmds[numdrawcmds++];
+}
+
+
+static void R_QueueColumnFunc (void (*func) (void))
+{
+  drawcmd_t*  cmd;
+
+  // Zero length, nothing to draw.
+  if (dc_yl > dc_yh)
+  {
+    return;
+  }
+
+  cmd = R_NewDrawCmd ();
+  R_SaveColumn (cmd);
+  cmd->func = func;
+}
+
+void R_QueueColumn (void)
+{
+  R_QueueColumnFunc (detailshift ? R_DrawColumnLow : R_DrawColumn);
+}
+
+void R_QueueWallColumn (void)
+{
+  if (detailshift)
+  {
+    R_QueueColumnFunc (R_DrawColumnLow);
+  }
+  else
+  {
+    R_QueueColumnFunc (columnmajor ? R_DrawColumn : R_DrawColumnQuad);
+  }
+}
+
+void R_QueueTranslatedColumn (void)
+{
+  R_QueueColumnFunc (R_DrawTranslatedColumn);
+}
+
+void R_QueueFuzzColumn (void)
+{
+  int   yl;
+  int   yh;
+
+  R_QueueColumnFunc (R_DrawFuzzColumn);
+
+  // Step through the fuzz table like R_DrawFuzzColumn will,
+  //  so the next shadow column continues at the same place.
+  yl = dc_yl ? dc_yl : 1;
+  yh = dc_yh == viewheight - 1 ? viewheight - 2 : dc_yh;
+
+  if (yl <= yh)
+  {
+    fuzzpos = (fuzzpos + yh - yl + 1) % FUZZTABLE;
+  }
+}
+
+void R_QueueSpan (void)
+{
+  drawcmd_t*  cmd;
+
+  cmd = R_NewDrawCmd ();
+  R_SaveSpan (cmd);
+  cmd->func = detailshift ? R_DrawSpanLow : R_DrawSpan;
+}
+
+
+//
+// R_DrawBand
+// Replays the queue, clipped to one column band.
+//
+static void R_DrawBand (int band)
+{
+  const drawcmd_t*  cmd;
+  const drawcmd_t*  end;
+  int     x1;
+  int     x2;
+
+  x1 = viewwidth * band / numrenderthreads;
+  x2 = viewwidth * (band + 1) / numrenderthreads - 1;
+
+  end = drawcmds + numdrawcmds;
+
+  for (cmd = drawcmds ; cmd < end ; cmd++)
+  {
+    if (cmd->x2 < x1 || cmd->x1 > x2)
+    {
+      continue;
+    }
+
+    if (cmd->func != R_DrawColumnQuad)
+    {
+      R_FlushColumns ();
+    }
+
+    if (!cmd->span)
+    {
+      R_LoadColumn (cmd);
+      cmd->func ();
+      continue;
+    }
+
+    R_LoadSpan (cmd);
+
+    if (ds_x1 < x1)
+    {
+      // Same as stepping from the span start.
+      ds_xfrac = (unsigned)ds_xfrac + (unsigned)(x1 - ds_x1) * ds_xstep;
+      ds_yfrac = (unsigned)ds_yfrac + (unsigned)(x1 - ds_x1) * ds_ystep;
+      ds_x1 = x1;
+    }
+
+    if (ds_x2 > x2)
+    {
+      ds_x2 = x2;
+    }
+
+    cmd->func ();
+  }
+
+  R_FlushColumns ();
+}
+
+
+//
+// R_FlushDrawQueue
+//
+void R_FlushDrawQueue (void)
+{
+  drawcmd_t   column;
+  drawcmd_t   span;
+
+  if (!numdrawcmds)
+  {
+    return;
+  }
+
+  // This thread draws the first band itself,
+  //  keep the parameters the refresh code is working on.
+  R_SaveColumn (&column);
+  R_SaveSpan (&span);
+
+  I_RunParallel (numrenderthreads, R_DrawBand);
+
+  R_LoadColumn (&column);
+  R_LoadSpan (&span);
+
+  numdrawcmds = 0;
+}
+
+
+//
+// R_TransposeBand
+// Band edges are kept on 16 pixel blocks.
+//
+static void R_TransposeBand (int band)
+{
+  int     x1;
+  int     x2;
+
+  x1 = (scaledviewwidth * band / numrenderthreads) & ~15;
+
+  if (band == numrenderthreads - 1)
+  {
+    x2 = scaledviewwidth;
+  }
+  else
+  {
+    x2 = (scaledviewwidth * (band + 1) / numrenderthreads) & ~15;
+  }
+
+  R_TransposeView (x1, x2 - 1);
+}
+
+
+//
+// R_TransposeBands
+//
+void R_TransposeBands (void)
+{
+  if (numrenderthreads > 1)
+  {
+    I_RunParallel (numrenderthreads, R_TransposeBand);
+  }
+  else
+  {
+    R_TransposeView (0, scaledviewwidth - 1);
+  }
+}
@@ -0,0 +1,52 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+// DESCRIPTION:
+//  Refresh, drawing split into vertical column bands on worker threads.
+//
+//-----------------------------------------------------------------------------
+#ifndef __R_THREAD__
+#define __R_THREAD__
+
+// Number of column bands, set with -rthreads.
+extern int    numrenderthreads;
+
+// Reads -rthreads, called by R_Init.
+void R_InitRenderThreads (void);
+
+// Stand-ins for colfunc, wallcolfunc, fuzzcolfunc,
+//  transcolfunc and spanfunc that queue the draw for the workers.
+void R_QueueColumn (void);
+void R_QueueWallColumn (void);
+void R_QueueFuzzColumn (void);
+void R_QueueTranslatedColumn (void);
+void R_QueueSpan (void);
+
+// Draws everything queued so far, one band per thread.
+// Called at the end of R_RenderPlayerView, and by the zone
+//  before purging blocks the queued draws might point into.
+void R_FlushDrawQueue (void);
+
+// Copies a column-major view into screens[0],
+//  one band of columns per thread.
+void R_TransposeBands (void);
+
+#endif
+//-----------------------------------------------------------------------------
+//
+// $Log:$
+//
+//-----------------------------------------------------------------------------
@@ -257,7 +257,7 @@
     (strlen(mapnames[(gameepisode-1)*9+(gamemap-1)]))
 
 #define ST_MAPTITLEX \
-    (SCREENWIDTH - ST_MAPWIDTH * ST_CHATFONTWIDTH)
+    (ORIGWIDTH - ST_MAPWIDTH * ST_CHATFONTWIDTH)
 
 #define ST_MAPTITLEY    0
 #define ST_MAPHEIGHT    1
@@ -1545,5 +1545,6 @@ void ST_Init (void)
 {
   veryfirsttime = 0;
   ST_loadData();
-  screens[4] = (uint8_t*) Z_Malloc(ST_WIDTH * ST_HEIGHT, PU_STATIC, 0);
+  screens[4] = (uint8_t*) Z_Malloc(SCREENWIDTH * V_ScaleY(ST_HEIGHT),
+                                   PU_STATIC, 0);
 }
@@ -26,11 +26,11 @@
 
 #include "d_event.h"
 
-// Size of statusbar.
-// Now sensitive for scaling.
-#define ST_HEIGHT 32*SCREEN_MUL
-#define ST_WIDTH  SCREENWIDTH
-#define ST_Y    (SCREENHEIGHT - ST_HEIGHT)
+// Size of statusbar, in 320x200 coordinates.
+// V_DrawPatch and V_CopyRect scale it to the screen.
+#define ST_HEIGHT 32
+#define ST_WIDTH  ORIGWIDTH
+#define ST_Y    (ORIGHEIGHT - ST_HEIGHT)
 
 
 //
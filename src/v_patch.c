@@ -0,0 +1,265 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+// $Log:$
+//
+// DESCRIPTION:
+//  Patch cache.
+//  A patch lump is a list of column offsets, each column a chain
+//   of posts with their pixels inline, that every draw walks.
+//  The first draw converts it into a table of posts per column,
+//   all in one array, and the pixels packed after them, each
+//   post still between its two pad bytes; later draws, flipped
+//   or not, index straight into those.
+//  Converted patches are PU_CACHE blocks owned by patchcache[],
+//   so the zone purges them like the lumps they came from.
+//
+//-----------------------------------------------------------------------------
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <SDL_endian.h>
+
+#include "i_system.h"
+#include "z_zone.h"
+#include "m_swap.h"
+#include "w_wad.h"
+#include "m_profile.h"
+
+#include "v_patch.h"
+
+// Converted patches by lump.
+static vpatch_t** patchcache;
+
+// For patches that are not cached lumps.
+static vpatch_t*  scratchpatch;
+static int        scratchsize;
+
+
+//
+// V_PatchSize
+// Returns the bytes V_BuildPatch needs for a patch.
+//
+static int V_PatchSize (const patch_t* patch, int* numposts)
+{
+  const column_t* column;
+  int   width;
+  int   pixels;
+  int   x;
+
+  width = SHORT(patch->width);
+  *numposts = 0;
+  pixels = 0;
+
+  for (x = 0 ; x < width ; x++)
+  {
+    column = (const column_t*) ((const uint8_t*)patch
+                                + LONG(patch->columnofs[x]));
+
+    while (column->topdelta != 0xff)
+    {
+      (*numposts)++;
+      pixels += column->length + 2;
+      column = (const column_t*) ((const uint8_t*)column
+                                  + column->length + 4);
+    }
+  }
+
+  return sizeof(vpatch_t) + (width + 1) * sizeof(int)
+         + *numposts * sizeof(vpost_t) + pixels;
+}
+
+
+//
+// V_BuildPatch
+// Converts a patch into dest, sized by V_PatchSize.
+//
+static void
+V_BuildPatch
+( const patch_t*  patch,
+  int   numposts,
+  vpatch_t*   dest )
+{
+  const column_t* column;
+  vpost_t*  post;
+  int     pixels;
+  int     x;
+
+  dest->width = SHORT(patch->width);
+  dest->height = SHORT(patch->height);
+  dest->leftoffset = SHORT(patch->leftoffset);
+  dest->topoffset = SHORT(patch->topoffset);
+
+  dest->columns = (int*) (dest + 1);
+  dest->posts = (vpost_t*) (dest->columns + dest->width + 1);
+  dest->pixels = (uint8_t*) (dest->posts + numposts);
+
+  post = dest->posts;
+  pixels = 0;
+
+  for (x = 0 ; x < dest->width ; x++)
+  {
+    dest->columns[x] = post - dest->posts;
+
+    column = (const column_t*) ((const uint8_t*)patch
+                                + LONG(patch->columnofs[x]));
+
+    while (column->topdelta != 0xff)
+    {
+      post->top = column->topdelta;
+      post->length = column->length;
+      post->pixels = pixels + 1;
+
+      // The pad bytes either side come along: masked drawing
+      //  can round one texel past either end of a post.
+      memcpy (dest->pixels + pixels, (const uint8_t*)column + 2,
+              column->length + 2);
+
+      pixels += column->length + 2;
+      post++;
+      column = (const column_t*) ((const uint8_t*)column
+                                  + column->length + 4);
+    }
+  }
+
+  dest->columns[x] = post - dest->posts;
+}
+
+
+//
+// V_ConvertPatch
+// Converts the patch cached for a lump into patchcache.
+//
+static vpatch_t* V_ConvertPatch (int lump, patch_t* patch)
+{
+  memblock_t* block;
+  int   size;
+  int   numposts;
+  int   tag;
+
+  if (!patchcache)
+  {
+    patchcache = calloc (W_NumLumps (), sizeof(*patchcache));
+
+    if (!patchcache)
+    {
+      I_Error ("V_ConvertPatch: no memory");
+    }
+  }
+
+  size = V_PatchSize (patch, &numposts);
+
+  // Keep the lump through the allocation, whatever its tag.
+  block = (memblock_t*) ((uint8_t*)patch - sizeof(memblock_t));
+  tag = block->tag;
+  Z_ChangeTag (patch, PU_STATIC);
+
+  Z_Malloc (size, PU_CACHE, &patchcache[lump]);
+  V_BuildPatch (patch, numposts, patchcache[lump]);
+
+  Z_ChangeTag (patch, tag);
+
+  PROFILE_COUNT (PROF_PATCHMISSES, 1);
+  return patchcache[lump];
+}
+
+
+//
+// V_CachePatchNum
+//
+vpatch_t* V_CachePatchNum (int lump)
+{
+  if (patchcache && patchcache[lump])
+  {
+    PROFILE_COUNT (PROF_PATCHHITS, 1);
+    return patchcache[lump];
+  }
+
+  return V_ConvertPatch (lump, W_CacheLumpNum (lump, PU_CACHE));
+}
+
+
+//
+// V_CachePatch
+//
+vpatch_t* V_CachePatch (patch_t* patch)
+{
+  int   lump;
+  int   size;
+  int   numposts;
+
+  lump = W_LumpNumForData (patch);
+
+  if (lump >= 0)
+  {
+    if (patchcache && patchcache[lump])
+    {
+      PROFILE_COUNT (PROF_PATCHHITS, 1);
+      return patchcache[lump];
+    }
+
+    return V_ConvertPatch (lump, patch);
+  }
+
+  size = V_PatchSize (patch, &numposts);
+
+  if (size > scratchsize)
+  {
+    scratchpatch = realloc (scratchpatch, size);
+
+    if (!scratchpatch)
+    {
+      I_Error ("V_CachePatch: no memory");
+    }
+    scratchsize = size;
+  }
+
+  V_BuildPatch (patch, numposts, scratchpatch);
+  PROFILE_COUNT (PROF_PATCHMISSES, 1);
+
+  return scratchpatch;
+}
+
+
+//
+// V_PatchCacheSize
+//
+int V_PatchCacheSize (void)
+{
+  memblock_t* block;
+  int   size;
+  int   i;
+
+  if (!patchcache)
+  {
+    return 0;
+  }
+
+  size = 0;
+
+  for (i = 0 ; i < W_NumLumps () ; i++)
+  {
+    if (patchcache[i])
+    {
+      block = (memblock_t*) ((uint8_t*)patchcache[i] - sizeof(memblock_t));
+      size += block->size;
+    }
+  }
+
+  return size;
+}
@@ -0,0 +1,65 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+// DESCRIPTION:
+//  Patch cache, patches and sprites converted once
+//   from their column_t posts into a flat run table.
+//
+//-----------------------------------------------------------------------------
+#ifndef __V_PATCH__
+#define __V_PATCH__
+
+#include "r_defs.h"
+
+// A run of opaque pixels.
+typedef struct
+{
+  short     top;    // rows below the top of the patch
+  short     length;
+  int       pixels; // offset of the first pixel in pixels,
+                    //  which keeps the pad bytes either side
+} vpost_t;
+
+typedef struct
+{
+  short     width;
+  short     height;
+  short     leftoffset;
+  short     topoffset;
+
+  // Column x is posts[columns[x]] up to posts[columns[x + 1]],
+  //  which flipped drawing indexes from the other end.
+  int*      columns;
+  vpost_t*  posts;
+  uint8_t*  pixels;
+} vpatch_t;
+
+// Converted patch for a lump, purgable.
+vpatch_t* V_CachePatchNum (int lump);
+
+// Same for a patch read through W_CacheLumpNum. Other patches
+//  are converted into a scratch buffer, valid until the next call.
+vpatch_t* V_CachePatch (patch_t* patch);
+
+// Bytes held by converted patches, for the profiler.
+int V_PatchCacheSize (void);
+
+#endif
+//-----------------------------------------------------------------------------
+//
+// $Log:$
+//
+//-----------------------------------------------------------------------------
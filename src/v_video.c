@@ -23,6 +23,7 @@
 //
 //-----------------------------------------------------------------------------
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <string.h>
@@ -30,6 +31,7 @@
 #include <SDL_endian.h>
 
 #include "i_system.h"
+#include "m_argv.h"
 #include "m_fixed.h"
 
 #include "doomdef.h"
@@ -39,13 +41,20 @@
 #include "m_swap.h"
 
 #include "v_video.h"
+#include "v_patch.h"
 
 
+int   SCREENWIDTH = ORIGWIDTH;
+int   SCREENHEIGHT = ORIGHEIGHT;
+
 // Each screen is [SCREENWIDTH*SCREENHEIGHT];
 uint8_t*       screens[5];
 
 int       dirtybox[4];
 
+dirtyrect_t   dirtyrects[MAXDIRTYRECTS];
+int           numdirtyrects;
+
 
 
 // Now where did these came from?
@@ -147,6 +156,92 @@ uint8_t gammatable[5][256] =
 
 int usegamma;
 
+//
+// V_UnionRect
+//
+static void V_UnionRect (dirtyrect_t* rect, const dirtyrect_t* other)
+{
+  if (other->x1 < rect->x1)
+  {
+    rect->x1 = other->x1;
+  }
+  if (other->y1 < rect->y1)
+  {
+    rect->y1 = other->y1;
+  }
+  if (other->x2 > rect->x2)
+  {
+    rect->x2 = other->x2;
+  }
+  if (other->y2 > rect->y2)
+  {
+    rect->y2 = other->y2;
+  }
+}
+
+
+//
+// V_AddDirtyRect
+// Rectangles that overlap or touch are merged, so a line of
+//  characters ends up as one. When the list is full the new one
+//  goes into the rectangle it grows the least.
+//
+static void V_AddDirtyRect (dirtyrect_t rect)
+{
+  dirtyrect_t*  r;
+  dirtyrect_t   u;
+  int           best;
+  int64_t       bestgrowth;
+  int64_t       growth;
+  int           i;
+
+  // Merging can make a rectangle reach others, so start over
+  //  with the union until nothing is left to merge.
+  i = 0;
+  while (i < numdirtyrects)
+  {
+    r = &dirtyrects[i];
+    if (rect.x1 > r->x2 || rect.x2 < r->x1
+        || rect.y1 > r->y2 || rect.y2 < r->y1)
+    {
+      i++;
+      continue;
+    }
+
+    V_UnionRect (&rect, r);
+    *r = dirtyrects[--numdirtyrects];
+    i = 0;
+  }
+
+  if (numdirtyrects < MAXDIRTYRECTS)
+  {
+    dirtyrects[numdirtyrects++] = rect;
+    return;
+  }
+
+  best = 0;
+  bestgrowth = INT64_MAX;
+  for (i = 0 ; i < numdirtyrects ; i++)
+  {
+    r = &dirtyrects[i];
+    u = rect;
+    V_UnionRect (&u, r);
+    growth = (int64_t)(u.x2 - u.x1) * (u.y2 - u.y1)
+             - (int64_t)(r->x2 - r->x1) * (r->y2 - r->y1);
+    if (growth < bestgrowth)
+    {
+      bestgrowth = growth;
+      best = i;
+    }
+  }
+
+  // The union can reach the others now.
+  V_UnionRect (&rect, &dirtyrects[best]);
+  dirtyrects[best] = dirtyrects[--numdirtyrects];
+  V_AddDirtyRect (rect);
+}
+
+
 //
 // V_MarkRect
 //
@@ -157,13 +252,39 @@ V_MarkRect
   int   width,
   int   height )
 {
+  dirtyrect_t rect;
+
   M_AddToBox (dirtybox, x, y);
   M_AddToBox (dirtybox, x + width - 1, y + height - 1);
+
+  rect.x1 = x < 0 ? 0 : x;
+  rect.y1 = y < 0 ? 0 : y;
+  rect.x2 = x + width > SCREENWIDTH ? SCREENWIDTH : x + width;
+  rect.y2 = y + height > SCREENHEIGHT ? SCREENHEIGHT : y + height;
+
+  if (rect.x1 < rect.x2 && rect.y1 < rect.y2)
+  {
+    V_AddDirtyRect (rect);
+  }
+}
+
+
+//
+// V_ClearDirtyRects
+// Called by I_FinishUpdate once the rectangles are on screen.
+//
+void V_ClearDirtyRects (void)
+{
+  numdirtyrects = 0;
 }
 
 
 //
 // V_CopyRect
+// The rectangle is in 320x200 coordinates. It is scaled
+//  where it lands, and the source is the same pixels moved
+//  by the scaled offset between the two, so copies between
+//  the same places always line up (status bar background).
 //
 void
 V_CopyRect
@@ -178,25 +299,37 @@ V_CopyRect
 {
   uint8_t* src;
   uint8_t* dest;
+  int   x;
+  int   y;
 
 #ifdef RANGECHECK
   if (srcx < 0
-      || srcx + width > SCREENWIDTH
+      || srcx + width > ORIGWIDTH
       || srcy < 0
-      || srcy + height > SCREENHEIGHT
-      || destx < 0 || destx + width > SCREENWIDTH
+      || srcy + height > ORIGHEIGHT
+      || destx < 0 || destx + width > ORIGWIDTH
       || desty < 0
-      || desty + height > SCREENHEIGHT
+      || desty + height > ORIGHEIGHT
       || (unsigned)srcscrn > 4
       || (unsigned)destscrn > 4)
   {
     I_Error ("Bad V_CopyRect");
   }
 #endif
-  V_MarkRect (destx, desty, width, height);
 
-  src = screens[srcscrn] + SCREENWIDTH * srcy + srcx;
-  dest = screens[destscrn] + SCREENWIDTH * desty + destx;
+  x = V_ScaleX (destx);
+  y = V_ScaleY (desty);
+  width = V_ScaleX (destx + width) - x;
+  height = V_ScaleY (desty + height) - y;
+
+  V_MarkRect (x, y, width, height);
+
+  dest = screens[destscrn] + SCREENWIDTH * y + x;
+
+  x += srcx >= destx ? V_ScaleX (srcx - destx) : -V_ScaleX (destx - srcx);
+  y += srcy >= desty ? V_ScaleY (srcy - desty) : -V_ScaleY (desty - srcy);
+
+  src = screens[srcscrn] + SCREENWIDTH * y + x;
 
   for ( ; height > 0 ; height--)
   {
@@ -208,71 +341,123 @@ V_CopyRect
 
 
 //
-// V_DrawPatch
-// Masks a column based masked pic to the screen.
+// V_DrawScaledPatch
+// Draws a patch placed in 320x200 coordinates.
+// Screen pixel x shows 320x200 column x * 320 / SCREENWIDTH,
+//  the same for rows. Both are stepped with a remainder,
+//  which at 320x200 makes this a plain copy.
 //
-void
-V_DrawPatch
+static void
+V_DrawScaledPatch
 ( int   x,
   int   y,
   int   scrn,
-  patch_t*  patch )
+  patch_t*  patch,
+  bool    flipped )
 {
-
-  int   count;
+  int   w;
   int   col;
-  column_t* column;
-  uint8_t* desttop;
+  int   colfrac;
+  int   row;
+  int   rowfrac;
+  int   top;
+  int   dx;
+  int   dxend;
+  int   dy;
+  int   dyend;
+  int   column;
+  vpatch_t* vpatch;
+  vpost_t*  post;
+  vpost_t*  end;
   uint8_t* dest;
   uint8_t* source;
-  int   w;
 
-  y -= SHORT(patch->topoffset);
-  x -= SHORT(patch->leftoffset);
-#ifdef RANGECHECK
-  if (x < 0
-      || x + SHORT(patch->width) > SCREENWIDTH
-      || y < 0
-      || y + SHORT(patch->height) > SCREENHEIGHT
-      || (unsigned)scrn > 4)
-  {
-    fprintf( stderr, "Patch at %d,%d exceeds LFB\n", x, y );
-    // No I_Error abort - what is up with TNT.WAD?
-    fprintf( stderr, "V_DrawPatch: bad patch (ignored)\n");
-    return;
-  }
-#endif
+  vpatch = V_CachePatch (patch);
+  w = vpatch->width;
 
   if (!scrn)
   {
-    V_MarkRect (x, y, SHORT(patch->width), SHORT(patch->height));
+    V_MarkRect (V_ScaleX (x), V_ScaleY (y),
+                V_ScaleX (x + w) - V_ScaleX (x),
+                V_ScaleY (y + vpatch->height) - V_ScaleY (y));
   }
 
+  dx = V_ScaleX (x);
+  dxend = V_ScaleX (x + w);
   col = 0;
-  desttop = screens[scrn] + y * SCREENWIDTH + x;
-
-  w = SHORT(patch->width);
+  colfrac = dx * ORIGWIDTH - x * SCREENWIDTH;
 
-  for ( ; col < w ; x++, col++, desttop++)
+  for ( ; dx < dxend ; dx++)
   {
-    column = (column_t*)((uint8_t*)patch + LONG(patch->columnofs[col]));
+    column = flipped ? w - 1 - col : col;
+    post = vpatch->posts + vpatch->columns[column];
+    end = vpatch->posts + vpatch->columns[column + 1];
 
     // step through the posts in a column
-    while (column->topdelta != 0xff )
+    for ( ; post < end ; post++)
     {
-      source = (uint8_t*)column + 3;
-      dest = desttop + column->topdelta * SCREENWIDTH;
-      count = column->length;
+      source = vpatch->pixels + post->pixels;
+      top = y + post->top;
+
+      dy = V_ScaleY (top);
+      dyend = V_ScaleY (top + post->length);
+      row = 0;
+      rowfrac = dy * ORIGHEIGHT - top * SCREENHEIGHT;
 
-      while (count--)
+      dest = screens[scrn] + dy * SCREENWIDTH + dx;
+
+      for ( ; dy < dyend ; dy++)
       {
-        *dest = *source++;
+        *dest = source[row];
         dest += SCREENWIDTH;
+
+        rowfrac += ORIGHEIGHT;
+        if (rowfrac >= SCREENHEIGHT)
+        {
+          rowfrac -= SCREENHEIGHT;
+          row++;
+        }
       }
-      column = (column_t*)(  (uint8_t*)column + column->length
-                             + 4 );
     }
+
+    colfrac += ORIGWIDTH;
+    if (colfrac >= SCREENWIDTH)
+    {
+      colfrac -= SCREENWIDTH;
+      col++;
+    }
+  }
+}
+
+
+//
+// V_DrawPatch
+// Masks a column based masked pic to the screen.
+//
+void
+V_DrawPatch
+( int   x,
+  int   y,
+  int   scrn,
+  patch_t*  patch )
+{
+  y -= SHORT(patch->topoffset);
+  x -= SHORT(patch->leftoffset);
+#ifdef RANGECHECK
+  if (x < 0
+      || x + SHORT(patch->width) > ORIGWIDTH
+      || y < 0
+      || y + SHORT(patch->height) > ORIGHEIGHT
+      || (unsigned)scrn > 4)
+  {
+    fprintf( stderr, "Patch at %d,%d exceeds LFB\n", x, y );
+    // No I_Error abort - what is up with TNT.WAD?
+    fprintf( stderr, "V_DrawPatch: bad patch (ignored)\n");
+    return;
   }
+#endif
+
+  V_DrawScaledPatch (x, y, scrn, patch, false);
 }
 
 //
@@ -287,22 +472,13 @@ V_DrawPatchFlipped
   int   scrn,
   patch_t*  patch )
 {
-
-  int   count;
-  int   col;
-  column_t* column;
-  uint8_t* desttop;
-  uint8_t* dest;
-  uint8_t* source;
-  int   w;
-
   y -= SHORT(patch->topoffset);
   x -= SHORT(patch->leftoffset);
 #ifdef RANGECHECK
   if (x < 0
-      || x + SHORT(patch->width) > SCREENWIDTH
+      || x + SHORT(patch->width) > ORIGWIDTH
       || y < 0
-      || y + SHORT(patch->height) > SCREENHEIGHT
+      || y + SHORT(patch->height) > ORIGHEIGHT
       || (unsigned)scrn > 4)
   {
     fprintf( stderr, "Patch origin %d,%d exceeds LFB\n", x, y );
@@ -310,36 +486,7 @@ V_DrawPatchFlipped
   }
 #endif
 
-  if (!scrn)
-  {
-    V_MarkRect (x, y, SHORT(patch->width), SHORT(patch->height));
-  }
-
-  col = 0;
-  desttop = screens[scrn] + y * SCREENWIDTH + x;
-
-  w = SHORT(patch->width);
-
-  for ( ; col < w ; x++, col++, desttop++)
-  {
-    column = (column_t*)((uint8_t*)patch + LONG(patch->columnofs[w - 1 - col]));
-
-    // step through the posts in a column
-    while (column->topdelta != 0xff )
-    {
-      source = (uint8_t*)column + 3;
-      dest = desttop + column->topdelta * SCREENWIDTH;
-      count = column->length;
-
-      while (count--)
-      {
-        *dest = *source++;
-        dest += SCREENWIDTH;
-      }
-      column = (column_t*)(  (uint8_t*)column + column->length
-                             + 4 );
-    }
-  }
+  V_DrawScaledPatch (x, y, scrn, patch, true);
 }
 
 //
@@ -418,10 +565,46 @@ V_GetBlock
   }
 }
 
+/**
+ * Picks the screen size from -width and -height, keeping
+ * the 320x200 aspect ratio when only one of them is given,
+ * then allocates the buffer screens.
+ */
 void V_Init()
 {
-  const size_t size = SCREENWIDTH * SCREENHEIGHT * 4;
-  uint8_t* base = (uint8_t*) malloc(size);
+  const int width = M_CheckParm("-width");
+  const int height = M_CheckParm("-height");
+  size_t size;
+  uint8_t* base;
+
+  if (width && width < myargc - 1)
+  {
+    SCREENWIDTH = atoi(myargv[width + 1]);
+    SCREENHEIGHT = SCREENWIDTH * ORIGHEIGHT / ORIGWIDTH;
+  }
+  if (height && height < myargc - 1)
+  {
+    SCREENHEIGHT = atoi(myargv[height + 1]);
+    if (!width)
+    {
+      SCREENWIDTH = SCREENHEIGHT * ORIGWIDTH / ORIGHEIGHT;
+    }
+  }
+
+  if (SCREENWIDTH < ORIGWIDTH || SCREENWIDTH > MAXSCREENWIDTH
+      || SCREENHEIGHT < ORIGHEIGHT || SCREENHEIGHT > MAXSCREENHEIGHT)
+  {
+    I_Error("V_Init: %ix%i is not between %ix%i and %ix%i",
+            SCREENWIDTH, SCREENHEIGHT, ORIGWIDTH, ORIGHEIGHT,
+            MAXSCREENWIDTH, MAXSCREENHEIGHT);
+  }
+
+  size = (size_t) SCREENWIDTH * SCREENHEIGHT * 4;
+  base = (uint8_t*) malloc(size);
+  if (!base)
+  {
+    I_Error("V_Init: no memory for %ix%i screens", SCREENWIDTH, SCREENHEIGHT);
+  }
 
   memset(base, 0, size);
   for (int i = 0; i < 4; ++i)
@@ -36,6 +36,11 @@
 
 #define CENTERY     (SCREENHEIGHT/2)
 
+// First screen pixel of a 320x200 coordinate.
+// Pixels [V_ScaleX(x), V_ScaleX(x + 1)) show column x.
+#define V_ScaleX(x) (((x) * SCREENWIDTH + ORIGWIDTH - 1) / ORIGWIDTH)
+#define V_ScaleY(y) (((y) * SCREENHEIGHT + ORIGHEIGHT - 1) / ORIGHEIGHT)
+
 
 // Screen 0 is the screen updated by I_Update screen.
 // Screen 1 is an extra buffer.
@@ -46,15 +51,32 @@ extern  uint8_t*   screens[5];
 
 extern  int dirtybox[4];
 
+// Screen 0 rectangles drawn since the last V_ClearDirtyRects,
+//  so I_FinishUpdate only has to upload those.
+// x2 and y2 are exclusive.
+#define MAXDIRTYRECTS 16
+
+typedef struct
+{
+  int   x1, y1;
+  int   x2, y2;
+} dirtyrect_t;
+
+extern  dirtyrect_t dirtyrects[MAXDIRTYRECTS];
+extern  int numdirtyrects;
+
 extern  uint8_t  gammatable[5][256];
 extern  int usegamma;
 
 
 
-// Allocates buffer screens, call before R_Init.
+// Sets the screen size and allocates buffer screens,
+//  call before R_Init.
 void V_Init (void);
 
 
+// Patches and rectangles are placed in 320x200
+//  coordinates and scaled to the screen.
 void
 V_CopyRect
 ( int   srcx,
@@ -73,7 +95,15 @@ V_DrawPatch
   int   scrn,
   patch_t*  patch);
 
+void
+V_DrawPatchFlipped
+( int   x,
+  int   y,
+  int   scrn,
+  patch_t*  patch);
+
 // Draw a linear block of pixels into the view buffer.
+// Blocks and V_MarkRect are in screen pixels.
 void
 V_DrawBlock
 ( int   x,
@@ -101,6 +131,8 @@ V_MarkRect
   int   width,
   int   height );
 
+void V_ClearDirtyRects (void);
+
 #endif
 //-----------------------------------------------------------------------------
 //
@@ -391,6 +391,54 @@ int W_GetNumForName(const char* name)
   return index;
 }
 
+/**
+ * Hashes the loaded WAD set: the lump directory, plus the size and
+ * modification time of every open file. Returns 0 when a reloadable
+ * file is loaded, since its contents may change while running.
+ */
+uint64_t W_HashWadSet(void)
+{
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  int lasthandle = -1;
+  struct stat fileinfo;
+  int32_t fields[4];
+  const uint8_t* bytes;
+
+  for (int i = 0; i < numlumps; ++i)
+  {
+    const lumpinfo_t* l = &lumpinfo[i];
+
+    if (l->handle == -1)
+    {
+      return 0;
+    }
+
+    memset(fields, 0, sizeof(fields));
+    if (l->handle != lasthandle && fstat(l->handle, &fileinfo) != -1)
+    {
+      fields[2] = (int32_t) fileinfo.st_size;
+      fields[3] = (int32_t) fileinfo.st_mtime;
+      lasthandle = l->handle;
+    }
+    fields[0] = l->position;
+    fields[1] = l->size;
+
+    // FNV-1a over the name and the fields above.
+    bytes = (const uint8_t*) l->name;
+    for (int j = 0; j < 8; ++j)
+    {
+      hash = (hash ^ bytes[j]) * 0x100000001b3ULL;
+    }
+    bytes = (const uint8_t*) fields;
+    for (int j = 0; j < (int) sizeof(fields); ++j)
+    {
+      hash = (hash ^ bytes[j]) * 0x100000001b3ULL;
+    }
+  }
+
+  return hash ? hash : 1;
+}
+
 //
 // W_LumpLength
 // Returns the buffer size needed to load the given lump.
@@ -475,6 +523,29 @@ void* W_CacheLumpNum(int lump, int tag)
   return result;
 }
 
+//
+// W_LumpNumForData
+// Returns the lump that data was cached from by W_CacheLumpNum,
+//  or -1, for code that is only handed the data.
+//
+int W_LumpNumForData (const void* data)
+{
+  memblock_t* block;
+  uintptr_t   offset;
+
+  // The zone block owner of a cached lump is its lumpcache slot.
+  block = (memblock_t*) ((uint8_t*)data - sizeof(memblock_t));
+  offset = (uintptr_t)block->user - (uintptr_t)lumpcache;
+
+  if (offset >= numlumps * sizeof(*lumpcache)
+      || lumpcache[offset / sizeof(*lumpcache)] != data)
+  {
+    return -1;
+  }
+
+  return offset / sizeof(*lumpcache);
+}
+
 //
 // W_CacheLumpName
 //
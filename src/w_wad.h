@@ -59,6 +59,7 @@ extern  lumpinfo_t* lumpinfo;
 void    W_InitMultipleFiles (char** filenames);
 void    W_Reload (void);
 
+int W_NumLumps (void);
 int W_CheckNumForName(const char* name);
 int W_GetNumForName(const char* name);
 
@@ -67,6 +68,9 @@ void    W_ReadLump (int lump, void* dest);
 
 void* W_CacheLumpNum (int lump, int tag);
 void* W_CacheLumpName (char* name, int tag);
+int W_LumpNumForData (const void* data);
+
+uint64_t W_HashWadSet(void);
 
 
 
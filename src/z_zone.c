@@ -58,6 +58,9 @@ typedef struct
 
 memzone_t*  mainzone;
 
+// Called before a purgable block is thrown out.
+static void (*purgehook) (void);
+
 //
 // Z_Init
 //
@@ -87,6 +90,18 @@ void Z_Init (void)
 }
 
 
+//
+// Z_SetPurgeHook
+// Users that hold on to pointers into purgable blocks
+//  past the next allocation (deferred drawing)
+//  get a chance to finish with them here.
+//
+void Z_SetPurgeHook (void (*hook) (void))
+{
+  purgehook = hook;
+}
+
+
 //
 // Z_Free
 //
@@ -102,7 +117,7 @@ void Z_Free (void* ptr)
     I_Error ("Z_Free: freed a pointer without ZONEID");
   }
 
-  if (block->user)
+  if (block->user > (void**)0x100)
   {
     // smaller values are not pointers
     // Note: OS-dependend?
@@ -210,6 +225,10 @@ Z_Malloc
       else
       {
         // free the rover block (adding the size to base)
+        if (purgehook)
+        {
+          purgehook ();
+        }
 
         // the rover can be the base block
         base = base->prev;
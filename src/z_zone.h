@@ -48,6 +48,7 @@ void    Z_Free (void* ptr);
 void    Z_FreeTags (int lowtag, int hightag);
 void    Z_CheckHeap (void);
 void    Z_ChangeTag2 (void* ptr, int tag);
+void    Z_SetPurgeHook (void (*hook) (void));
 
 
 typedef struct memblock_s